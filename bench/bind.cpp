@@ -0,0 +1,72 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+
+#include <formatstring.h>
+
+using namespace formatstring;
+
+// Binds arguments to one format that is shared by all threads, once by
+// copying the format (which touches its reference count) and once through
+// a FormatRef (which doesn't), and reports the time per bind for a growing
+// number of threads.
+
+static const Format shared = compile("x={} y={}");
+
+template<typename Bind>
+static double run(unsigned int threads, std::size_t iterations, Bind bind) {
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<std::size_t> sink(0);
+
+    for (unsigned int i = 0; i < threads; ++ i) {
+        workers.emplace_back([&]() {
+            ++ ready;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            std::size_t local = 0;
+            for (std::size_t j = 0; j < iterations; ++ j) {
+                local += bind((int)j);
+            }
+            sink += local;
+        });
+    }
+
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, const char* argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    unsigned int max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 4;
+    }
+
+    const FormatRef ref = shared.ref();
+
+    std::cout << format("{: >8} {: >16} {: >16}\n", "threads", "Format ns/op", "FormatRef ns/op");
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        double owning = run(threads, iterations, [](int x) { auto&& bound = shared(x, 2); return sizeof(bound); });
+        double view   = run(threads, iterations, [&ref](int x) { auto&& bound = ref(x, 2); return sizeof(bound); });
+        std::cout << format("{: >8} {: >16.1f} {: >16.1f}\n", threads, owning, view);
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#include <formatstring.h>
+
+#include "nullbuffer.h"
+
+using namespace formatstring;
+
+// Formats small values the way a caller does, through format_value() and
+// through a compiled format, and reports the time per call. Run it against
+// the default shared library and against a static one built with
+// -DWITH_STATIC=ON -DWITH_LTO=ON to see what the call into the library
+// costs when the formatters can't be inlined.
+
+template<typename Func>
+static double measure(std::size_t iterations, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++ i) {
+        func(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, const char* argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+
+    NullBuffer buffer;
+    std::ostream out(&buffer);
+    const FormatSpec spec;
+    const FormatSpec hex = parse_spec("x");
+    const Format small = compile("{}");
+    const Format pair = compile("{}:{}");
+
+#ifdef FORMATSTRING_STATIC_LIB
+    const char* library = "static";
+#else
+    const char* library = "shared";
+#endif
+
+#ifdef FORMATSTRING_BENCH_LTO
+    const char* lto = "on";
+#else
+    const char* lto = "off";
+#endif
+
+    std::cout << format("library: {}, LTO: {}, {} iterations\n", library, lto, iterations);
+    std::cout << format("{: <24} {: >10}\n", "case", "ns/op");
+
+    struct Case {
+        const char* name;
+        double      ns;
+    } cases[] = {
+        {"format_value int",    measure(iterations, [&](std::size_t i) { format_value(out, (int)(i & 7), spec); })},
+        {"format_value hex",    measure(iterations, [&](std::size_t i) { format_value(out, (unsigned int)(i & 255), hex); })},
+        {"format_value long",   measure(iterations, [&](std::size_t i) { format_value(out, (long)(i & 7), spec); })},
+        {"format_value bool",   measure(iterations, [&](std::size_t i) { format_value(out, (i & 1) != 0, spec); })},
+        {"format_value double", measure(iterations, [&](std::size_t i) { format_value(out, (double)(i & 7), spec); })},
+        {"Format \"{}\" int",   measure(iterations, [&](std::size_t i) { small.format(out, (int)(i & 7)); })},
+        {"Format \"{}:{}\"",    measure(iterations, [&](std::size_t i) { pair.format(out, (int)(i & 7), 'x'); })},
+    };
+
+    for (const Case& c : cases) {
+        std::cout << format("{: <24} {: >10.1f}\n", c.name, c.ns);
+    }
+
+    return 0;
+}
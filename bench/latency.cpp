@@ -0,0 +1,181 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+
+#include <formatstring.h>
+
+using namespace formatstring;
+
+// Records the latency of every single write_into() and str() call in a
+// histogram and reports its percentiles, because allocations when a
+// stream or string grows show up in the tail and not in the mean.
+// write_into() writes into a fresh std::ostringstream per call, created
+// outside of the timed region, so its growth is part of every sample.
+//
+// Every sample includes the cost of reading the clock twice, the "clock"
+// row shows how much that is.
+//
+// usage: bench_latency [iterations]
+
+// Log-linear buckets like an HDR histogram: values below 2^PRECISION are
+// exact, above that every power of two is split into 2^PRECISION buckets,
+// so the relative error is below 1 / 2^PRECISION.
+class Histogram {
+public:
+    static const unsigned int PRECISION = 7;
+    static const std::uint64_t SUB_BUCKETS = 1 << PRECISION;
+
+    Histogram() : m_counts(64 * SUB_BUCKETS, 0), m_count(0), m_sum(0), m_max(0) {}
+
+    inline void record(std::uint64_t value) {
+        ++ m_counts[index(value)];
+        ++ m_count;
+        m_sum += value;
+        if (value > m_max) {
+            m_max = value;
+        }
+    }
+
+    // highest value that is equivalent to the percentile's bucket
+    std::uint64_t percentile(double percent) const {
+        std::uint64_t rank = (std::uint64_t)(percent / 100.0 * m_count + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < m_counts.size(); ++ bucket) {
+            seen += m_counts[bucket];
+            if (seen >= rank) {
+                std::uint64_t upper = highest(bucket);
+                return upper < m_max ? upper : m_max;
+            }
+        }
+        return m_max;
+    }
+
+    inline std::uint64_t count() const { return m_count; }
+    inline std::uint64_t max()   const { return m_max; }
+    inline double mean() const { return m_count ? (double)m_sum / m_count : 0.0; }
+
+private:
+    static std::size_t index(std::uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return (std::size_t)value;
+        }
+        unsigned int shift = 0;
+        while ((value >> shift) >= 2 * SUB_BUCKETS) {
+            ++ shift;
+        }
+        return (std::size_t)(shift * SUB_BUCKETS + (value >> shift));
+    }
+
+    static std::uint64_t highest(std::size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        unsigned int shift = (unsigned int)(index / SUB_BUCKETS - 1);
+        std::uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_count;
+    std::uint64_t m_sum;
+    std::uint64_t m_max;
+};
+
+static std::size_t iterations = 200000;
+
+static void report(const std::string& name, const Histogram& histogram) {
+    std::cout << format("{: <40} {: >9.1f} {: >9} {: >9} {: >9} {: >9}\n",
+                        name, histogram.mean(), histogram.percentile(50.0), histogram.percentile(99.0),
+                        histogram.percentile(99.9), histogram.max());
+}
+
+// func(i) is timed, prepare(i) runs right before it and isn't
+template<typename Prepare, typename Func>
+static void bench(const std::string& name, Prepare prepare, Func func) {
+    Histogram histogram;
+
+    for (std::size_t i = 0; i < 1000; ++ i) {
+        prepare(i);
+        func(i);
+    }
+
+    for (std::size_t i = 0; i < iterations; ++ i) {
+        prepare(i);
+        auto start = std::chrono::steady_clock::now();
+        func(i);
+        auto end = std::chrono::steady_clock::now();
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    report(name, histogram);
+}
+
+// bind(i, use) binds the arguments of call i and passes the bound format to use
+template<typename Bind>
+static void workload(const std::string& name, Bind bind) {
+    std::ostringstream* out = nullptr;
+    std::string str;
+
+    bench(name + " write_into", [&](std::size_t) {
+        delete out;
+        out = new std::ostringstream();
+    }, [&](std::size_t i) {
+        bind(i, [&](const BasicBoundFormat<char>& bound) { bound.write_into(*out); });
+    });
+    delete out;
+
+    bench(name + " str()", [](std::size_t) {}, [&](std::size_t i) {
+        bind(i, [&](const BasicBoundFormat<char>& bound) { str = bound.str(); });
+    });
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc > 1) {
+        iterations = std::strtoul(argv[1], nullptr, 10);
+    }
+
+    std::cout << format("nanoseconds per call, {} calls per case\n", iterations);
+    std::cout << format("{: <40} {: >9} {: >9} {: >9} {: >9} {: >9}\n", "case", "mean", "p50", "p99", "p99.9", "max");
+
+    bench("clock", [](std::size_t) {}, [](std::size_t) {});
+
+    const Format log = compile("{} {: <5} [{}] request {} from {} took {:.3f} ms: {!r}\n");
+    const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    workload("log line", [&](std::size_t i, auto use) {
+        use(log((std::int64_t)1700000000000 + (std::int64_t)i, levels[i & 3], "http.server",
+                (unsigned int)i, "192.168.0.17", 0.25 * (double)(i & 1023), "GET /index.html"));
+    });
+
+    const Format metrics = compile("{},host={},region={} value={:.6f},count={}i {}\n");
+    workload("metrics line", [&](std::size_t i, auto use) {
+        use(metrics("cpu_usage", "web-17", "eu-central", (double)(i & 4095) / 4096.0,
+                    (std::uint64_t)i, (std::int64_t)1700000000000000000 + (std::int64_t)i));
+    });
+
+    std::vector<int> vector;
+    for (int i = 0; i < 1000; ++ i) {
+        vector.push_back(i * 7919);
+    }
+    std::map<std::string,double> map;
+    for (int i = 0; i < 100; ++ i) {
+        map[format("key{}", i)] = i * 0.5;
+    }
+    const Format dump = compile("{}\n");
+    const Format repr = compile("{!r}\n");
+    workload("vector<int>[1000]", [&](std::size_t, auto use) {
+        use(dump(vector));
+    });
+    workload("map<string,double>[100] {!r}", [&](std::size_t, auto use) {
+        use(repr(map));
+    });
+
+    return 0;
+}
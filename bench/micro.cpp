@@ -0,0 +1,185 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <formatstring.h>
+
+#include "nullbuffer.h"
+
+using namespace formatstring;
+
+// Microbenchmarks per value type and spec, with snprintf and ostringstream
+// as baselines. Reports the time, the number of allocations and the number
+// of allocated bytes per operation. Output goes to a stream that discards
+// it, so only formatting is measured.
+//
+// usage: bench_micro [iterations] [filter]
+// Only cases whose name contains filter are run.
+
+#ifdef FORMATSTRING_ALLOC_STATS
+// the library replaces operator new and counts per thread
+static inline std::size_t alloc_count() { return thread_alloc_counter().allocations; }
+static inline std::size_t alloc_bytes() { return thread_alloc_counter().bytes; }
+#else
+// see newcount.cpp
+extern std::size_t bench_alloc_count;
+extern std::size_t bench_alloc_bytes;
+
+static inline std::size_t alloc_count() { return bench_alloc_count; }
+static inline std::size_t alloc_bytes() { return bench_alloc_bytes; }
+#endif
+
+static NullBuffer null_buffer;
+static std::ostream out(&null_buffer);
+static std::size_t iterations = 1000000;
+static const char* filter = "";
+
+template<typename Func>
+static void bench(const std::string& name, Func func) {
+    if (!std::strstr(name.c_str(), filter)) {
+        return;
+    }
+
+    // warm up thread local scratch buffers and the like
+    for (std::size_t i = 0; i < 1000; ++ i) {
+        func(i);
+    }
+
+    std::size_t count = alloc_count();
+    std::size_t bytes = alloc_bytes();
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++ i) {
+        func(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    double allocs = (double)(alloc_count() - count) / iterations;
+    double allocated = (double)(alloc_bytes() - bytes) / iterations;
+
+    std::cout << format("{: <32} {: >10.1f} {: >10.2f} {: >10.1f}\n", name, ns, allocs, allocated);
+}
+
+static void section(const char* name) {
+    std::cout << format("\n{}\n", name);
+}
+
+template<typename Int>
+static void bench_int(const char* type) {
+    static const char* const specs[] = {"{}", "{:x}", "{:b}", "{:o}"};
+    for (const char* spec : specs) {
+        const Format fmt = compile(spec);
+        bench(format("{} {}", type, spec).str(), [&fmt](std::size_t i) {
+            fmt.format(out, (Int)(i * 2654435761u));
+        });
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc > 1) {
+        iterations = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        filter = argv[2];
+    }
+
+    std::cout << format("{: <32} {: >10} {: >10} {: >10}\n", "case", "ns/op", "allocs/op", "bytes/op");
+
+    section("integers");
+    bench_int<std::int8_t>("int8");
+    bench_int<std::int16_t>("int16");
+    bench_int<std::int32_t>("int32");
+    bench_int<std::int64_t>("int64");
+    bench_int<std::uint8_t>("uint8");
+    bench_int<std::uint16_t>("uint16");
+    bench_int<std::uint32_t>("uint32");
+    bench_int<std::uint64_t>("uint64");
+
+    section("floats");
+    {
+        static const char* const specs[] = {
+            "{}", "{:e}", "{:f}", "{:g}", "{:%}",
+#ifdef FORMATSTRING_HEXFLOAT_SUPPORT
+            "{:a}",
+#endif
+            "{:.3f}"
+        };
+        for (const char* spec : specs) {
+            const Format fmt = compile(spec);
+            bench(format("double {}", spec).str(), [&fmt](std::size_t i) {
+                fmt.format(out, 1234.5678 + (double)(i & 15));
+            });
+        }
+        const Format fmt = compile("{}");
+        bench("float {}", [&fmt](std::size_t i) {
+            fmt.format(out, 3.25f + (float)(i & 15));
+        });
+    }
+
+    section("strings");
+    {
+        const char* str = "hello world";
+        const std::string string = "hello world";
+        const Format plain  = compile("{}");
+        const Format right  = compile("{: >24}");
+        const Format center = compile("{:_^24}");
+        const Format repr   = compile("{!r}");
+        const Format conv   = compile("{!s: >16}");
+        bench("const char* {}",          [&](std::size_t) { plain.format(out, str); });
+        bench("std::string {}",          [&](std::size_t) { plain.format(out, string); });
+        bench("const char* {: >24}",     [&](std::size_t) { right.format(out, str); });
+        bench("const char* {:_^24}",     [&](std::size_t) { center.format(out, str); });
+        bench("const char* {!r}",        [&](std::size_t) { repr.format(out, str); });
+        bench("int {!s: >16}",           [&](std::size_t i) { conv.format(out, (int)i); });
+        bench("int {!r}",                [&](std::size_t i) { repr.format(out, (int)i); });
+    }
+
+    section("containers");
+    {
+        const std::vector<int> vector = {1, 2, 3, 4, 5, 6, 7, 8};
+        const std::map<std::string,int> map = {{"one", 1}, {"two", 2}, {"three", 3}};
+        const Format plain = compile("{}");
+        const Format repr  = compile("{!r}");
+        bench("vector<int>[8] {}",       [&](std::size_t) { plain.format(out, vector); });
+        bench("map<string,int>[3] {}",   [&](std::size_t) { plain.format(out, map); });
+        bench("map<string,int>[3] {!r}", [&](std::size_t) { repr.format(out, map); });
+    }
+
+    section("parsing and binding");
+    {
+        const char* fmt = "name={!r} id={:08x} value={:.3f} tags={}";
+        const Format compiled = compile(fmt);
+        bench("parse_format",            [&](std::size_t) { parse_format(fmt); });
+        bench("parse_spec",              [&](std::size_t) { parse_spec("_>+#020,.3f"); });
+        bench("format() and write",      [&](std::size_t i) { out << format(fmt, "x", (int)i, 1.5, 3); });
+        bench("compiled and write",      [&](std::size_t i) { compiled.format(out, "x", (int)i, 1.5, 3); });
+        bench("format().str()",          [&](std::size_t i) { format("{}", (int)i).str(); });
+    }
+
+    section("baselines");
+    {
+        char buffer[64];
+        bench("snprintf %d",             [&](std::size_t i) { out.write(buffer, std::snprintf(buffer, sizeof(buffer), "%d", (int)(i * 2654435761u))); });
+        bench("snprintf %x",             [&](std::size_t i) { out.write(buffer, std::snprintf(buffer, sizeof(buffer), "%x", (unsigned int)(i * 2654435761u))); });
+        bench("snprintf %g",             [&](std::size_t i) { out.write(buffer, std::snprintf(buffer, sizeof(buffer), "%g", 1234.5678 + (double)(i & 15))); });
+        bench("snprintf %.3f",           [&](std::size_t i) { out.write(buffer, std::snprintf(buffer, sizeof(buffer), "%.3f", 1234.5678 + (double)(i & 15))); });
+        bench("snprintf %24s",           [&](std::size_t) { out.write(buffer, std::snprintf(buffer, sizeof(buffer), "%24s", "hello world")); });
+        bench("ostream << int",          [&](std::size_t i) { out << (int)(i * 2654435761u); });
+        bench("ostream << double",       [&](std::size_t i) { out << 1234.5678 + (double)(i & 15); });
+        bench("ostringstream << int",    [&](std::size_t i) {
+            std::ostringstream buf;
+            buf << (int)(i * 2654435761u);
+            out << buf.str();
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+// Replaces the global operator new and delete for bench_micro to count
+// allocations. It's a translation unit of its own, so callers can't
+// inline free() and GCC doesn't warn about mismatched new and delete.
+// Not built with WITH_ALLOC_STATS, the library replaces them then.
+
+std::size_t bench_alloc_count = 0;
+std::size_t bench_alloc_bytes = 0;
+
+void* operator new(std::size_t size) {
+    ++ bench_alloc_count;
+    bench_alloc_bytes += size;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,21 @@
+#ifndef FORMATSTRING_BENCH_NULLBUFFER_H
+#define FORMATSTRING_BENCH_NULLBUFFER_H
+#pragma once
+
+#include <streambuf>
+
+// Stream buffer for the benchmarks' output. It discards everything, so
+// only formatting is measured.
+class NullBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override {
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char* str, std::streamsize count) override {
+        (void)str;
+        return count;
+    }
+};
+
+#endif // FORMATSTRING_BENCH_NULLBUFFER_H
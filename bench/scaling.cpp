@@ -0,0 +1,120 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+
+#include <formatstring.h>
+
+#include "nullbuffer.h"
+
+using namespace formatstring;
+
+// Formats with a growing number of threads and reports the throughput, to
+// show where threads contend with each other:
+//
+//   shared format()     one Format used by all threads, no copies
+//   shared bind         one Format, bound per call, which copies the format
+//                       and so touches its reference count
+//   per-thread format() a Format compiled by every thread
+//   grouping {:,}       imbues the shared thousands grouping locale
+//   str()               allocates a string per call
+//
+// usage: bench_scaling [iterations per thread] [max threads]
+
+static const Format shared = compile("id={} value={} name={}");
+static const Format grouping = compile("{:,}");
+
+// Func is called as func(out, i) on every thread. Returns million
+// operations per second over all threads.
+template<typename Func>
+static double run(unsigned int threads, std::size_t iterations, Func func) {
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> ready(0);
+    std::atomic<bool> go(false);
+
+    for (unsigned int i = 0; i < threads; ++ i) {
+        workers.emplace_back([&]() {
+            NullBuffer buffer;
+            std::ostream out(&buffer);
+            Func local = func;
+
+            ++ ready;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (std::size_t j = 0; j < iterations; ++ j) {
+                local(out, j);
+            }
+        });
+    }
+
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    return (double)threads * iterations / us;
+}
+
+// compiles its own copy on construction, so every thread has one
+struct PerThread {
+    Format fmt;
+
+    PerThread() : fmt(compile("id={} value={} name={}")) {}
+    PerThread(const PerThread&) : PerThread() {}
+
+    inline void operator () (std::ostream& out, std::size_t i) const {
+        fmt.format(out, (int)i, 0.5, "name");
+    }
+};
+
+int main(int argc, const char* argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned int max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 4;
+    }
+
+    std::cout << format("million ops/s over all threads, {} iterations per thread\n", iterations);
+    std::cout << format("{: >8} {: >12} {: >12} {: >12} {: >12} {: >12}\n",
+                        "threads", "shared", "shared bind", "per-thread", "grouping", "str()");
+
+    for (unsigned int threads = 1;; threads *= 2) {
+        if (threads > max_threads) {
+            threads = max_threads;
+        }
+
+        double direct = run(threads, iterations, [](std::ostream& out, std::size_t i) {
+            shared.format(out, (int)i, 0.5, "name");
+        });
+        double bound = run(threads, iterations, [](std::ostream& out, std::size_t i) {
+            shared((int)i, 0.5, "name").write_into(out);
+        });
+        double own = run(threads, iterations, PerThread());
+        double grouped = run(threads, iterations, [](std::ostream& out, std::size_t i) {
+            grouping.format(out, (int)i * 1000);
+        });
+        double strings = run(threads, iterations, [](std::ostream& out, std::size_t i) {
+            out << shared((int)i, 0.5, "name").str();
+        });
+
+        std::cout << format("{: >8} {: >12.2f} {: >12.2f} {: >12.2f} {: >12.2f} {: >12.2f}\n",
+                            threads, direct, bound, own, grouped, strings);
+
+        if (threads >= max_threads) {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <array>
 #include <tuple>
 #include <cmath>
+#include <memory>
 
 #include <fstream>
 
@@ -239,6 +240,11 @@ int main() {
     }
 
     std::cout << "{} {}\n"_fmt("foo",12);
+
+    // parsed once, then reused on every iteration
+    for (int i = 0; i < 3; ++ i) {
+        std::cout << FORMATSTRING_STATIC("static {}\n")(i);
+    }
     std::cout << format("{{\n");
     std::cout << format(std::string("{}\n"), std::string("x"));
 
@@ -3,13 +3,27 @@
 #pragma once
 
 #include "formatstring/config.h"
+#include "formatstring/allocstats.h"
+#include "formatstring/asyncwriter.h"
+#include "formatstring/batchformat.h"
+#include "formatstring/binarylog.h"
+#include "formatstring/catalog.h"
 #include "formatstring/conversion.h"
 #include "formatstring/exceptions.h"
+#include "formatstring/fixedformat.h"
 #include "formatstring/format.h"
 #include "formatstring/format_traits.h"
 #include "formatstring/formatitem.h"
 #include "formatstring/formatspec.h"
+#include "formatstring/formatstats.h"
 #include "formatstring/formatter.h"
 #include "formatstring/formattedvalue.h"
+#include "formatstring/ownedformat.h"
+#include "formatstring/print.h"
+#include "formatstring/probes.h"
+#include "formatstring/safeformat.h"
+#include "formatstring/scratch.h"
+#include "formatstring/sharedwriter.h"
+#include "formatstring/vectoredwriter.h"
 
 #endif // FORMMATSTRING_H
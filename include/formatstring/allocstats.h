@@ -0,0 +1,98 @@
+#ifndef FORMATSTRING_ALLOCSTATS_H
+#define FORMATSTRING_ALLOCSTATS_H
+#pragma once
+
+#include "formatstring/config.h"
+
+// Allocation accounting, compiled in with WITH_ALLOC_STATS=ON. The library
+// then replaces the global operator new and delete to count the
+// allocations of every thread, and attributes the allocations made while
+// parsing, binding and applying a format to that format. Binding through
+// format() with a format string is accounted as parsing and applying only.
+// Programs that replace operator new themselves can't use this.
+//
+// Formats are told apart by the address of their items, so a format that
+// is freed and a later one that is allocated at the same address share
+// their counters, the label of the latter is shown then.
+
+#ifdef FORMATSTRING_ALLOC_STATS
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "formatstring/export.h"
+
+#define FORMATSTRING_ALLOC_SCOPE(name, key, phase) ::formatstring::AllocScope name((key), ::formatstring::phase)
+
+namespace formatstring {
+
+    enum AllocPhase {
+        ParsePhase,
+        BindPhase,
+        ApplyPhase
+    };
+
+    struct AllocCounter {
+        std::size_t calls;
+        std::size_t allocations;
+        std::size_t bytes;
+    };
+
+    struct FormatAllocStats {
+        const void*  key;    // address of the format's items
+        std::string  label;  // the format string, non-ASCII characters as '?'
+        AllocCounter parse;
+        AllocCounter bind;
+        AllocCounter apply;
+    };
+
+    // Accounts the allocations of the calling thread during its lifetime.
+    // Scopes may be nested, the inner allocations count for both.
+    class FORMATSTRING_EXPORT AllocScope {
+    public:
+        AllocScope(const void* key, AllocPhase phase) noexcept;
+        ~AllocScope();
+
+        AllocScope(const AllocScope& other) = delete;
+        AllocScope& operator= (const AllocScope& other) = delete;
+
+        // for scopes that only know the format at the end, e.g. parsing
+        inline void set_key(const void* key) noexcept { m_key = key; }
+
+        // fmt has to stay alive until the scope ends
+        template<typename Char>
+        inline void set_label(const Char* fmt, std::size_t size) noexcept {
+            m_label = fmt;
+            m_label_size = size;
+            m_char_size = sizeof(Char);
+        }
+
+    private:
+        const void* m_key;
+        AllocPhase  m_phase;
+        std::size_t m_allocations;
+        std::size_t m_bytes;
+        const void* m_label;
+        std::size_t m_label_size;
+        std::size_t m_char_size;
+    };
+
+    // allocations and bytes of the calling thread since it started
+    FORMATSTRING_EXPORT AllocCounter thread_alloc_counter() noexcept;
+
+    FORMATSTRING_EXPORT std::vector<FormatAllocStats> alloc_stats();
+    FORMATSTRING_EXPORT void reset_alloc_stats();
+
+    // one line per format, ordered by the bytes allocated in total
+    FORMATSTRING_EXPORT void dump_alloc_stats(std::ostream& out);
+}
+
+#else
+
+#define FORMATSTRING_ALLOC_SCOPE(name, key, phase) ((void)0)
+
+#endif // FORMATSTRING_ALLOC_STATS
+
+#endif // FORMATSTRING_ALLOCSTATS_H
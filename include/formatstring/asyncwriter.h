@@ -0,0 +1,141 @@
+#ifndef FORMATSTRING_ASYNCWRITER_H
+#define FORMATSTRING_ASYNCWRITER_H
+#pragma once
+
+#include <iosfwd>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/ownedformat.h"
+
+namespace formatstring {
+
+    // What push() does when the queue is full.
+    enum OverflowPolicy {
+        BlockOnOverflow,     // wait until the writer thread made room
+        DropOnOverflow,      // discard the new record
+        DropOldestOnOverflow // discard the oldest queued record
+    };
+
+    struct AsyncWriterStats {
+        std::size_t   capacity;
+        std::size_t   depth;     // records currently queued
+        std::size_t   max_depth; // highest depth seen by the writer thread
+        std::uint64_t enqueued;
+        std::uint64_t written;
+        std::uint64_t dropped;
+        std::uint64_t errors;    // records whose formatting threw
+    };
+
+    // Formats and writes owned formats on a background thread. Producers
+    // move their records into a bounded lock-free ring buffer (a Vyukov
+    // queue, used with many producers and one consumer) and return, the
+    // writer thread takes them out in batches, writes them to the stream
+    // and flushes it once per batch. The stream must not be used by anyone
+    // else while the writer exists.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicAsyncWriter {
+    public:
+        typedef Char char_type;
+        typedef BasicOwnedFormat<Char> record_type;
+
+        // capacity is rounded up to a power of two
+        explicit BasicAsyncWriter(std::basic_ostream<Char>& out, std::size_t capacity = 1024,
+                                  OverflowPolicy policy = BlockOnOverflow, std::size_t batch = 64);
+
+        BasicAsyncWriter(const BasicAsyncWriter<Char>& other) = delete;
+        BasicAsyncWriter<Char>& operator= (const BasicAsyncWriter<Char>& other) = delete;
+
+        // writes everything still queued, then stops the writer thread
+        ~BasicAsyncWriter();
+
+        // Returns false if the record was dropped because the queue was full.
+        bool push(record_type&& record);
+
+        template<typename... Args>
+        inline bool write(const BasicFormatRef<Char>& format, const Args&... args) {
+            return push(format.bind_owned(args...));
+        }
+
+        template<typename... Args>
+        inline bool write(const BasicFormat<Char>& format, const Args&... args) {
+            return push(format.bind_owned(args...));
+        }
+
+        // waits until everything pushed before the call was written or dropped
+        void flush();
+
+        AsyncWriterStats stats() const noexcept;
+
+        inline OverflowPolicy policy() const noexcept { return m_policy; }
+        inline std::size_t capacity() const noexcept { return m_mask + 1; }
+
+    private:
+        typedef typename std::aligned_storage<sizeof(record_type), alignof(record_type)>::type Storage;
+
+        struct Slot {
+            std::atomic<std::size_t> seq;
+            Storage                  storage;
+        };
+
+        bool try_push(record_type& record);
+        bool try_pop(record_type* record);
+        void wake() noexcept;
+        void run();
+
+        std::basic_ostream<Char>& m_out;
+        const OverflowPolicy      m_policy;
+        const std::size_t         m_batch;
+        std::size_t               m_mask;
+        Slot*                     m_slots;
+
+        // producers and the consumer touch different cache lines
+        alignas(64) std::atomic<std::size_t> m_tail;
+        alignas(64) std::atomic<std::size_t> m_head;
+        alignas(64) std::atomic<std::uint64_t> m_completed; // written, failed or evicted
+        std::atomic<std::uint64_t> m_written;
+        std::atomic<std::uint64_t> m_dropped;
+        std::atomic<std::uint64_t> m_errors;
+        std::atomic<std::size_t>   m_max_depth;
+
+        std::atomic<bool>       m_sleeping;
+        std::atomic<bool>       m_stopping;
+        std::mutex              m_mutex;
+        std::condition_variable m_wakeup;
+        std::condition_variable m_progress;
+        std::thread             m_thread;
+    };
+
+    typedef BasicAsyncWriter<char>    AsyncWriter;
+    typedef BasicAsyncWriter<wchar_t> WAsyncWriter;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicAsyncWriter<char16_t> U16AsyncWriter;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicAsyncWriter<char32_t> U32AsyncWriter;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicAsyncWriter<char>;
+    extern template class FORMATSTRING_EXPORT BasicAsyncWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicAsyncWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicAsyncWriter<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_ASYNCWRITER_H
@@ -0,0 +1,104 @@
+#ifndef FORMATSTRING_BATCHFORMAT_H
+#define FORMATSTRING_BATCHFORMAT_H
+#pragma once
+
+#include <iosfwd>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/format_traits.h"
+
+namespace formatstring {
+
+    // Formats records [begin, end) of a batch into out.
+    template<typename Char>
+    using BasicBatchRenderer = void (*)(const void* context, std::size_t begin, std::size_t end, std::basic_ostream<Char>& out);
+
+    // Splits count records into chunks which are rendered by up to threads
+    // worker threads (0 means one per hardware thread), each into its own
+    // buffer, and writes the chunks to out in order. Only a few chunks are
+    // buffered at a time, so the memory used doesn't grow with count.
+    // Chunks are rendered with the locale of out. If rendering a record
+    // throws, the workers are stopped and the exception is rethrown once
+    // everything before the failing chunk was written. Nothing of that
+    // chunk is written, also if only one thread renders.
+    template<typename Char>
+    FORMATSTRING_EXPORT void render_batch(std::basic_ostream<Char>& out, std::size_t count, unsigned int threads,
+                                          BasicBatchRenderer<Char> render, const void* context);
+
+    template<typename Char, typename Record>
+    struct BatchContext {
+        const BasicFormatItems<Char>* items;
+        const Record*                 records;
+
+        template<std::size_t... I>
+        inline void format(std::basic_ostream<Char>& out, const Record& record, std::index_sequence<I...>) const {
+            items->apply(out, {format_traits<Char, typename std::tuple_element<I,Record>::type>::make_formatter(std::get<I>(record))...});
+        }
+
+        static void render(const void* context, std::size_t begin, std::size_t end, std::basic_ostream<Char>& out) {
+            const BatchContext<Char,Record>* batch = static_cast<const BatchContext<Char,Record>*>(context);
+            typedef std::make_index_sequence<std::tuple_size<Record>::value> Indices;
+            for (std::size_t i = begin; i < end; ++ i) {
+                batch->format(out, batch->records[i], Indices());
+            }
+        }
+    };
+
+    // Records are std::tuple, std::pair or std::array values holding the
+    // arguments of one call to format().
+    template<typename Char, typename Record>
+    inline void format_batch(const BasicFormatItems<Char>& items, const Record* records, std::size_t count,
+                             std::basic_ostream<Char>& out, unsigned int threads) {
+        BatchContext<Char,Record> context = {&items, records};
+        render_batch<Char>(out, count, threads, &BatchContext<Char,Record>::render, &context);
+    }
+
+    template<typename Char>
+    template<typename Record>
+    inline void BasicFormat<Char>::format_batch(const Record* records, std::size_t count, std::basic_ostream<Char>& out, unsigned int threads) const {
+        formatstring::format_batch(m_fmt, records, count, out, threads);
+    }
+
+    template<typename Char>
+    template<typename Record>
+    inline void BasicFormat<Char>::format_batch(const std::vector<Record>& records, std::basic_ostream<Char>& out, unsigned int threads) const {
+        formatstring::format_batch(m_fmt, records.data(), records.size(), out, threads);
+    }
+
+    template<typename Char>
+    template<typename Record>
+    inline void BasicFormatRef<Char>::format_batch(const Record* records, std::size_t count, std::basic_ostream<Char>& out, unsigned int threads) const {
+        formatstring::format_batch(m_items, records, count, out, threads);
+    }
+
+    template<typename Char>
+    template<typename Record>
+    inline void BasicFormatRef<Char>::format_batch(const std::vector<Record>& records, std::basic_ostream<Char>& out, unsigned int threads) const {
+        formatstring::format_batch(m_items, records.data(), records.size(), out, threads);
+    }
+
+    // ---- extern template instantiations ----
+    extern template FORMATSTRING_EXPORT void render_batch<char>(std::basic_ostream<char>& out, std::size_t count, unsigned int threads,
+                                                                BasicBatchRenderer<char> render, const void* context);
+    extern template FORMATSTRING_EXPORT void render_batch<wchar_t>(std::basic_ostream<wchar_t>& out, std::size_t count, unsigned int threads,
+                                                                   BasicBatchRenderer<wchar_t> render, const void* context);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT void render_batch<char16_t>(std::basic_ostream<char16_t>& out, std::size_t count, unsigned int threads,
+                                                                    BasicBatchRenderer<char16_t> render, const void* context);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT void render_batch<char32_t>(std::basic_ostream<char32_t>& out, std::size_t count, unsigned int threads,
+                                                                    BasicBatchRenderer<char32_t> render, const void* context);
+#endif
+}
+
+#endif // FORMATSTRING_BATCHFORMAT_H
@@ -0,0 +1,285 @@
+#ifndef FORMATSTRING_BINARYLOG_H
+#define FORMATSTRING_BINARYLOG_H
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/format_traits.h"
+#include "formatstring/catalog.h"
+#include "formatstring/scratch.h"
+
+namespace formatstring {
+
+    // Binary logs don't contain any text produced at the call site. A log
+    // starts with a header followed by a binary catalog (see catalog.h) of
+    // all the formats it uses. Every record after that is
+    //
+    //     uint32 index of the format in the catalog
+    //     uint8  number of arguments
+    //     per argument: uint8 tag, followed by the raw value
+    //
+    // in native byte order. Strings are stored as uint64 length followed by
+    // the characters. Arguments of other types are rendered to text when
+    // they are written, once for every field of the format that uses them
+    // and with that field's conversion and spec. They are stored as uint32
+    // number of fields followed by the texts in the order of the fields,
+    // each as uint64 length followed by the characters, and written as they
+    // are when the log is read.
+    namespace binarylog {
+        struct Header {
+            char          magic[8];
+            std::uint32_t version;
+            std::uint32_t char_size;
+            std::uint64_t catalog_size; // followed by the catalog, padded to 8 bytes
+        };
+
+        enum Tag {
+            Bool,
+            NarrowChar,   // char, signed char and unsigned char only in char logs
+            WideChar,     // the character type of the log if it isn't char
+            SignedChar,
+            UnsignedChar,
+            Int,
+            UInt,
+            Float,
+            Double,
+            LongDouble,
+            String,
+            Rendered
+        };
+
+        FORMATSTRING_EXPORT extern const char MAGIC[8];
+        FORMATSTRING_EXPORT extern const std::uint32_t VERSION;
+
+        inline void put(std::vector<char>& buffer, const void* data, std::size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        }
+
+        template<typename T>
+        inline void put(std::vector<char>& buffer, Tag tag, T value) {
+            buffer.push_back((char)tag);
+            put(buffer, &value, sizeof(value));
+        }
+
+        template<typename Char>
+        inline void put_chars(std::vector<char>& buffer, const Char* str, std::size_t length) {
+            std::uint64_t size = length;
+            put(buffer, &size, sizeof(size));
+            put(buffer, str, length * sizeof(Char));
+        }
+
+        template<typename Char>
+        inline void put_string(std::vector<char>& buffer, const Char* str, std::size_t length) {
+            buffer.push_back((char)String);
+            put_chars(buffer, str, length);
+        }
+
+        // number of fields of items that use argument index
+        template<typename Char>
+        std::size_t field_count(const BasicFormatItems<Char>& items, std::size_t index) {
+            std::size_t count = 0;
+            for (const BasicFormatItem<Char>& item : items) {
+                if (item.kind == BasicFormatItem<Char>::Value && item.index == index) {
+                    ++ count;
+                }
+            }
+            return count;
+        }
+
+        // Renders argument index for every field of items that uses it.
+        // Throws like formatting directly if a spec doesn't fit the value.
+        template<typename Char>
+        void put_rendered(std::vector<char>& buffer, const BasicFormatItems<Char>& items, std::size_t index, const BasicFormatter<Char>& formatter) {
+            std::uint32_t count = (std::uint32_t)field_count(items, index);
+            buffer.push_back((char)Rendered);
+            put(buffer, &count, sizeof(count));
+            for (const BasicFormatItem<Char>& item : items) {
+                if (item.kind == BasicFormatItem<Char>::Value && item.index == index) {
+                    BasicScratchBuffer<Char> text;
+                    formatter(text.stream(), item.conv, item.spec);
+                    put_chars(buffer, text.data(), text.size());
+                }
+            }
+        }
+    }
+
+    // ---- how arguments are encoded ----
+    // encode() appends argument index of a record using items to buffer.
+    template<typename Char, typename T, typename ENABLE = void>
+    struct binarylog_traits {
+        static inline void encode(std::vector<char>& buffer, const BasicFormatItems<Char>& items, std::size_t index, const T& value) {
+            binarylog::put_rendered(buffer, items, index, format_traits<Char,T>::make_formatter(value));
+        }
+    };
+
+    template<typename Char, typename T, binarylog::Tag tag, typename Stored = T>
+    struct binarylog_value_traits {
+        static inline void encode(std::vector<char>& buffer, const BasicFormatItems<Char>&, std::size_t, T value) {
+            binarylog::put<Stored>(buffer, tag, value);
+        }
+    };
+
+    template<typename Char> struct binarylog_traits<Char, bool>          : public binarylog_value_traits<Char, bool, binarylog::Bool, unsigned char> {};
+    template<> struct binarylog_traits<char, char>                       : public binarylog_value_traits<char, char, binarylog::NarrowChar> {};
+    template<> struct binarylog_traits<char, signed char>                : public binarylog_value_traits<char, signed char, binarylog::SignedChar> {};
+    template<> struct binarylog_traits<char, unsigned char>              : public binarylog_value_traits<char, unsigned char, binarylog::UnsignedChar> {};
+    template<typename Char> struct binarylog_traits<Char, float>         : public binarylog_value_traits<Char, float, binarylog::Float> {};
+    template<typename Char> struct binarylog_traits<Char, double>        : public binarylog_value_traits<Char, double, binarylog::Double> {};
+    template<typename Char> struct binarylog_traits<Char, long double>   : public binarylog_value_traits<Char, long double, binarylog::LongDouble> {};
+
+    template<typename Char>
+    struct binarylog_traits<Char, Char, typename std::enable_if<!std::is_same<Char, char>::value>::type> :
+        public binarylog_value_traits<Char, Char, binarylog::WideChar> {};
+
+    template<typename Char> struct binarylog_traits<Char, short>              : public binarylog_value_traits<Char, short, binarylog::Int, long long> {};
+    template<typename Char> struct binarylog_traits<Char, int>                : public binarylog_value_traits<Char, int, binarylog::Int, long long> {};
+    template<typename Char> struct binarylog_traits<Char, long>               : public binarylog_value_traits<Char, long, binarylog::Int, long long> {};
+    template<typename Char> struct binarylog_traits<Char, long long>          : public binarylog_value_traits<Char, long long, binarylog::Int, long long> {};
+    template<typename Char> struct binarylog_traits<Char, unsigned short>     : public binarylog_value_traits<Char, unsigned short, binarylog::UInt, unsigned long long> {};
+    template<typename Char> struct binarylog_traits<Char, unsigned int>       : public binarylog_value_traits<Char, unsigned int, binarylog::UInt, unsigned long long> {};
+    template<typename Char> struct binarylog_traits<Char, unsigned long>      : public binarylog_value_traits<Char, unsigned long, binarylog::UInt, unsigned long long> {};
+    template<typename Char> struct binarylog_traits<Char, unsigned long long> : public binarylog_value_traits<Char, unsigned long long, binarylog::UInt, unsigned long long> {};
+
+    template<typename Char>
+    struct binarylog_traits<Char, const Char*> {
+        static inline void encode(std::vector<char>& buffer, const BasicFormatItems<Char>&, std::size_t, const Char* value) {
+            binarylog::put_string(buffer, value, std::char_traits<Char>::length(value));
+        }
+    };
+
+    template<typename Char>
+    struct binarylog_traits<Char, Char*> : public binarylog_traits<Char, const Char*> {};
+
+    template<typename Char, std::size_t N>
+    struct binarylog_traits<Char, const Char[N]> : public binarylog_traits<Char, const Char*> {};
+
+    template<typename Char, std::size_t N>
+    struct binarylog_traits<Char, Char[N]> : public binarylog_traits<Char, const Char*> {};
+
+    template<typename Char>
+    struct binarylog_traits< Char, std::basic_string<Char> > {
+        static inline void encode(std::vector<char>& buffer, const BasicFormatItems<Char>&, std::size_t, const std::basic_string<Char>& value) {
+            binarylog::put_string(buffer, value.data(), value.size());
+        }
+    };
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char>
+    struct binarylog_traits< Char, std::basic_string_view<Char> > {
+        static inline void encode(std::vector<char>& buffer, const BasicFormatItems<Char>&, std::size_t, std::basic_string_view<Char> value) {
+            binarylog::put_string(buffer, value.data(), value.size());
+        }
+    };
+#endif
+
+    // Writes a binary log. All formats have to be known up front, they are
+    // referred to by their index in the catalog. A writer must not be used
+    // by several threads at once.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicBinaryLogWriter {
+    public:
+        typedef Char char_type;
+
+        static const std::size_t npos = BasicCatalogFile<Char>::npos;
+
+        // writes the header and the catalog of formats
+        BasicBinaryLogWriter(std::ostream& out, const BasicCatalogEntries<Char>& formats);
+
+        // throws std::out_of_range if there is no such id
+        std::size_t index(const std::basic_string<Char>& id) const;
+
+        inline const BasicCatalogFile<Char>& catalog() const noexcept { return m_catalog; }
+
+        // throws std::out_of_range if there is no format at index
+        template<typename... Args>
+        void write(std::size_t index, const Args&... args) {
+            static_assert(sizeof...(Args) <= 255, "too many arguments for a binary log record");
+            check_index(index);
+            const BasicFormat<Char> format = m_catalog.format(index);
+            std::uint32_t stored = (std::uint32_t)index;
+            std::size_t arg = 0;
+            m_buffer.clear();
+            binarylog::put(m_buffer, &stored, sizeof(stored));
+            m_buffer.push_back((char)sizeof...(Args));
+            int encode[] = {0, (binarylog_traits<Char,Args>::encode(m_buffer, format.items(), arg ++, args), 0)...};
+            (void)encode;
+            (void)arg;
+            flush_record();
+        }
+
+    private:
+        static BasicCatalogFile<Char> write_catalog(std::ostream& out, const BasicCatalogEntries<Char>& formats, std::vector<std::uint64_t>& storage);
+        void check_index(std::size_t index) const;
+        void flush_record();
+
+        std::ostream&              m_out;
+        std::vector<std::uint64_t> m_storage;
+        BasicCatalogFile<Char>     m_catalog;
+        std::vector<char>          m_buffer;
+    };
+
+    // Reads a binary log and renders its records as text.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicBinaryLogReader {
+    public:
+        typedef Char char_type;
+
+        // reads the header and the catalog
+        explicit BasicBinaryLogReader(std::istream& in);
+
+        inline const BasicCatalogFile<Char>& catalog() const noexcept { return m_catalog; }
+
+        // Formats the next record into out. Returns false at the end of
+        // the log, throws std::runtime_error if the log is corrupt.
+        bool next(std::basic_ostream<Char>& out);
+
+    private:
+        static BasicCatalogFile<Char> read_catalog(std::istream& in, std::vector<std::uint64_t>& storage);
+
+        std::istream&              m_in;
+        std::vector<std::uint64_t> m_storage;
+        BasicCatalogFile<Char>     m_catalog;
+    };
+
+    typedef BasicBinaryLogWriter<char>    BinaryLogWriter;
+    typedef BasicBinaryLogWriter<wchar_t> WBinaryLogWriter;
+    typedef BasicBinaryLogReader<char>    BinaryLogReader;
+    typedef BasicBinaryLogReader<wchar_t> WBinaryLogReader;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicBinaryLogWriter<char16_t> U16BinaryLogWriter;
+    typedef BasicBinaryLogReader<char16_t> U16BinaryLogReader;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicBinaryLogWriter<char32_t> U32BinaryLogWriter;
+    typedef BasicBinaryLogReader<char32_t> U32BinaryLogReader;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogWriter<char>;
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogWriter<wchar_t>;
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogReader<char>;
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogReader<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogWriter<char16_t>;
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogReader<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogWriter<char32_t>;
+    extern template class FORMATSTRING_EXPORT BasicBinaryLogReader<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_BINARYLOG_H
@@ -0,0 +1,314 @@
+#ifndef FORMATSTRING_CATALOG_H
+#define FORMATSTRING_CATALOG_H
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+
+namespace formatstring {
+
+    // Text catalogs contain one message per line:
+    //
+    //     # comment
+    //     message.id = format string {0} with \n escapes
+    //
+    // Whitespace around the id and before the format string is ignored.
+    // Supported escapes in the format string are \n, \r, \t and \\.
+    template<typename Char>
+    using BasicCatalogEntries = std::vector< std::pair< std::basic_string<Char>, std::basic_string<Char> > >;
+
+    typedef BasicCatalogEntries<char>    CatalogEntries;
+    typedef BasicCatalogEntries<wchar_t> WCatalogEntries;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicCatalogEntries<char16_t> U16CatalogEntries;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicCatalogEntries<char32_t> U32CatalogEntries;
+#endif
+
+    template<typename Char>
+    BasicCatalogEntries<Char> read_text_catalog(std::basic_istream<Char>& in);
+
+    // Binary catalogs store the compiled items of every format together with
+    // a shared pool for the literals and ids, so they can be used in place
+    // after mapping them into memory. They are specific to the character
+    // type, the byte order and the struct layout of the platform that wrote
+    // them, which the loader checks.
+    namespace catalog {
+        struct Header {
+            char          magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint32_t char_size;
+            std::uint32_t item_size;
+            std::uint64_t count;
+            std::uint64_t entries_offset;
+            std::uint64_t items_offset;
+            std::uint64_t item_count;
+            std::uint64_t chars_offset;
+            std::uint64_t char_count;
+        };
+
+        // entries are sorted by id
+        struct Entry {
+            std::uint64_t id_offset;       // in the character pool
+            std::uint64_t id_size;
+            std::uint64_t items_offset;    // index of the first item
+            std::uint64_t item_count;
+            std::uint64_t literals_offset; // in the character pool, base of the item offsets
+        };
+
+        FORMATSTRING_EXPORT extern const char MAGIC[8];
+        FORMATSTRING_EXPORT extern const std::uint32_t VERSION;
+        FORMATSTRING_EXPORT extern const std::uint32_t BYTE_ORDER_MARK;
+    }
+
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicCatalogWriter {
+    public:
+        typedef Char char_type;
+
+        void add(const std::basic_string<Char>& id, const std::basic_string<Char>& fmt);
+        void add(const BasicCatalogEntries<Char>& entries);
+
+        inline std::size_t size() const { return m_entries.size(); }
+
+        // throws std::invalid_argument on duplicate ids
+        void write(std::ostream& out) const;
+
+    private:
+        std::vector< std::pair< std::basic_string<Char>, BasicFormatItems<Char> > > m_entries;
+    };
+
+    // Read-only view of a binary catalog. The formats returned by it don't own
+    // their items, so they must not outlive the catalog.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicCatalogFile {
+    public:
+        typedef Char char_type;
+
+        static const std::size_t npos = (std::size_t)-1;
+
+        // Uses the catalog in data in place. The memory is not copied and
+        // must stay valid while the catalog is in use.
+        BasicCatalogFile(const void* data, std::size_t size);
+
+        // Maps the file into memory.
+        static BasicCatalogFile<Char> open(const std::string& path);
+
+        BasicCatalogFile(BasicCatalogFile<Char>&& other) noexcept;
+        BasicCatalogFile(const BasicCatalogFile<Char>& other) = delete;
+        ~BasicCatalogFile();
+
+        BasicCatalogFile<Char>& operator= (const BasicCatalogFile<Char>& other) = delete;
+
+        inline std::size_t size() const noexcept { return m_count; }
+
+        inline const Char* id_data(std::size_t index) const noexcept { return m_chars + m_entries[index].id_offset; }
+        inline std::size_t id_size(std::size_t index) const noexcept { return m_entries[index].id_size; }
+
+        inline std::basic_string<Char> id(std::size_t index) const {
+            return std::basic_string<Char>(id_data(index), id_size(index));
+        }
+
+        BasicFormat<Char> format(std::size_t index) const noexcept;
+
+        // returns npos if there is no such id
+        std::size_t index(const Char* id, std::size_t size) const noexcept;
+
+        inline std::size_t index(const std::basic_string<Char>& id) const noexcept {
+            return index(id.data(), id.size());
+        }
+
+        // throws std::out_of_range if there is no such id
+        BasicFormat<Char> at(const Char* id, std::size_t size) const;
+
+        inline BasicFormat<Char> at(const std::basic_string<Char>& id) const {
+            return at(id.data(), id.size());
+        }
+
+    private:
+        BasicCatalogFile() noexcept;
+
+        void init(const void* data, std::size_t size);
+        void unmap() noexcept;
+
+        void*                           m_mapping;
+        std::size_t                     m_mapping_size;
+        std::size_t                     m_count;
+        const catalog::Entry*           m_entries;
+        const BasicFormatItem<Char>*    m_items;
+        const Char*                     m_chars;
+    };
+
+    // A catalog that can be replaced at runtime while other threads keep
+    // formatting with it. Every load() builds a complete new snapshot and
+    // publishes it with std::atomic_store() on a shared_ptr; snapshots that
+    // are still in use by readers stay alive until the last reference is
+    // dropped.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicCatalog {
+    public:
+        typedef Char char_type;
+
+        static const std::size_t npos = BasicCatalogFile<Char>::npos;
+
+        // One immutable version of the catalog.
+        class Snapshot {
+        public:
+            inline std::size_t size() const noexcept { return m_file.size(); }
+            inline std::uint64_t generation() const noexcept { return m_generation; }
+
+            inline std::basic_string<Char> id(std::size_t index) const { return m_file.id(index); }
+            inline BasicFormat<Char> format(std::size_t index) const noexcept { return m_file.format(index); }
+
+            inline std::size_t index(const Char* id, std::size_t size) const noexcept { return m_file.index(id, size); }
+            inline std::size_t index(const std::basic_string<Char>& id) const noexcept { return m_file.index(id); }
+
+            inline BasicFormat<Char> at(const Char* id, std::size_t size) const { return m_file.at(id, size); }
+            inline BasicFormat<Char> at(const std::basic_string<Char>& id) const { return m_file.at(id); }
+
+        private:
+            friend class BasicCatalog<Char>;
+
+            Snapshot(BasicCatalogFile<Char>&& file, std::vector<std::uint64_t>&& storage, std::uint64_t generation) :
+                m_storage(std::move(storage)), m_file(std::move(file)), m_generation(generation) {}
+
+            std::vector<std::uint64_t> m_storage; // compiled catalog if it wasn't mapped from a file
+            BasicCatalogFile<Char>     m_file;
+            std::uint64_t              m_generation;
+        };
+
+        typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+        // Thread-local handle to the current snapshot. Looking something up
+        // only compares the catalog generation with an atomic load and takes
+        // the new snapshot through snapshot() when it changed, so readers
+        // only lock once per reload. Formats obtained through a reader don't
+        // own their items and are valid until the next call on the same
+        // reader.
+        class Reader {
+        public:
+            explicit Reader(const BasicCatalog<Char>& catalog) :
+                m_catalog(&catalog), m_generation(catalog.generation()), m_snapshot(catalog.snapshot()) {}
+
+            inline const Snapshot& snapshot() {
+                std::uint64_t generation = m_catalog->m_generation.load(std::memory_order_acquire);
+                if (generation != m_generation) {
+                    m_snapshot   = m_catalog->snapshot();
+                    m_generation = generation;
+                }
+                return *m_snapshot;
+            }
+
+            inline BasicFormat<Char> at(const Char* id, std::size_t size) { return snapshot().at(id, size); }
+            inline BasicFormat<Char> at(const std::basic_string<Char>& id) { return snapshot().at(id); }
+
+        private:
+            const BasicCatalog<Char>* m_catalog;
+            std::uint64_t             m_generation;
+            SnapshotPtr               m_snapshot;
+        };
+
+        // empty catalog
+        BasicCatalog();
+
+        explicit BasicCatalog(const std::string& path);
+        explicit BasicCatalog(const BasicCatalogEntries<Char>& entries);
+
+        BasicCatalog(const BasicCatalog<Char>& other) = delete;
+        BasicCatalog<Char>& operator= (const BasicCatalog<Char>& other) = delete;
+
+        // Loads a text or binary catalog, depending on the file contents. If
+        // loading fails the current snapshot stays in place and the error is
+        // thrown.
+        void load(const std::string& path);
+
+        // loads the file given to the last successful load() again
+        void reload();
+
+        void assign(const BasicCatalogEntries<Char>& entries);
+
+        // std::atomic_load() of a shared_ptr is not lock-free in the common
+        // standard libraries, they guard it with a mutex from a small pool.
+        // Use a Reader for lookups on hot paths.
+        SnapshotPtr snapshot() const {
+            return std::atomic_load(&m_snapshot);
+        }
+
+        inline std::uint64_t generation() const noexcept {
+            return m_generation.load(std::memory_order_acquire);
+        }
+
+        inline Reader reader() const {
+            return Reader(*this);
+        }
+
+    private:
+        SnapshotPtr compile(const BasicCatalogEntries<Char>& entries, std::uint64_t generation) const;
+        void publish(SnapshotPtr snapshot);
+
+        SnapshotPtr                m_snapshot;
+        std::atomic<std::uint64_t> m_generation;
+        std::mutex                 m_mutex; // serializes writers only
+        std::string                m_path;
+    };
+
+    typedef BasicCatalogWriter<char>    CatalogWriter;
+    typedef BasicCatalogWriter<wchar_t> WCatalogWriter;
+    typedef BasicCatalogFile<char>      CatalogFile;
+    typedef BasicCatalogFile<wchar_t>   WCatalogFile;
+    typedef BasicCatalog<char>          Catalog;
+    typedef BasicCatalog<wchar_t>       WCatalog;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicCatalogWriter<char16_t> U16CatalogWriter;
+    typedef BasicCatalogFile<char16_t>   U16CatalogFile;
+    typedef BasicCatalog<char16_t>       U16Catalog;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicCatalogWriter<char32_t> U32CatalogWriter;
+    typedef BasicCatalogFile<char32_t>   U32CatalogFile;
+    typedef BasicCatalog<char32_t>       U32Catalog;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template FORMATSTRING_EXPORT CatalogEntries read_text_catalog<char>(std::istream& in);
+    extern template FORMATSTRING_EXPORT WCatalogEntries read_text_catalog<wchar_t>(std::wistream& in);
+
+    extern template class FORMATSTRING_EXPORT BasicCatalogWriter<char>;
+    extern template class FORMATSTRING_EXPORT BasicCatalogWriter<wchar_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalogFile<char>;
+    extern template class FORMATSTRING_EXPORT BasicCatalog<char>;
+    extern template class FORMATSTRING_EXPORT BasicCatalogFile<wchar_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalog<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT U16CatalogEntries read_text_catalog<char16_t>(std::basic_istream<char16_t>& in);
+    extern template class FORMATSTRING_EXPORT BasicCatalogWriter<char16_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalogFile<char16_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalog<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT U32CatalogEntries read_text_catalog<char32_t>(std::basic_istream<char32_t>& in);
+    extern template class FORMATSTRING_EXPORT BasicCatalogWriter<char32_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalogFile<char32_t>;
+    extern template class FORMATSTRING_EXPORT BasicCatalog<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_CATALOG_H
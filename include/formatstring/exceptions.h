@@ -6,10 +6,53 @@
 #include <string>
 #include <cstdint>
 
+#include "formatstring/config.h"
 #include "formatstring/export.h"
 
+// Without exceptions errors that would be thrown go to the error handler
+// (see set_error_handler()) and the program is aborted.
+#ifdef FORMATSTRING_EXCEPTIONS
+#   define FORMATSTRING_THROW(...)   throw __VA_ARGS__
+#   define FORMATSTRING_TRY          try
+#   define FORMATSTRING_CATCH_ALL    catch (...)
+#   define FORMATSTRING_RETHROW      throw
+#else
+#   define FORMATSTRING_THROW(...)   ::formatstring::fatal_error((__VA_ARGS__).what())
+#   define FORMATSTRING_TRY          if (true)
+#   define FORMATSTRING_CATCH_ALL    else
+#   define FORMATSTRING_RETHROW      ((void)0)
+#endif
+
 namespace formatstring {
 
+    // Errors reported by the functions that don't throw.
+    enum FormatError {
+        NoFormatError,
+        ExpectedNumber,               // '.' at the end of a spec
+        AfterSignAlignmentNotAllowed, // '=' with a string type
+        ThousandsSeparatorNotAllowed, // ',' with a type other than d, e, f, g or %
+        AlternateFormNotAllowed,      // '#' with a string type
+        PrecisionNotAllowed,          // '.' with a non-float type
+        ExpectedConversion,           // '!' not followed by 'r' or 's'
+        ExpectedClosingBrace,         // unterminated replacement field or single '}'
+        CapacityExceeded,             // format doesn't fit into fixed storage
+        ArgumentIndexOutOfRange,      // replacement field without an argument
+        InvalidArgumentFormat         // spec doesn't apply to the argument's type
+    };
+
+    // a static string describing error
+    FORMATSTRING_EXPORT const char* format_error_message(FormatError error) noexcept;
+
+    // Called with the message of an error that can't be thrown because
+    // exceptions are disabled. The program is aborted when it returns.
+    typedef void (*ErrorHandler)(const char* what);
+
+    // Returns the previous handler. The default handler writes the message
+    // to stderr. Passing nullptr restores it.
+    FORMATSTRING_EXPORT ErrorHandler set_error_handler(ErrorHandler handler) noexcept;
+
+    [[noreturn]] FORMATSTRING_EXPORT void fatal_error(const char* what) noexcept;
+
     class FORMATSTRING_EXPORT InvalidFormatStringException : public std::invalid_argument {
     public:
         InvalidFormatStringException(std::string::size_type pos, const char* what);
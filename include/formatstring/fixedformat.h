@@ -0,0 +1,94 @@
+#ifndef FORMATSTRING_FIXEDFORMAT_H
+#define FORMATSTRING_FIXEDFORMAT_H
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/exceptions.h"
+#include "formatstring/formatitem.h"
+
+namespace formatstring {
+
+    // Parses fmt into caller supplied storage of capacity items and chars
+    // literal characters. Doesn't allocate or throw. On success count
+    // receives the number of items, on failure it is 0. If error_pos isn't
+    // null it receives the position in fmt where parsing stopped.
+    template<typename Char>
+    FormatError parse_format_into(const Char* fmt, std::size_t size,
+                                  BasicFormatItem<Char>* items, std::size_t capacity,
+                                  Char* literals, std::size_t chars,
+                                  std::size_t* count, std::size_t* error_pos = nullptr) noexcept;
+
+    // Compiled format items in fixed-capacity storage inside the object, for
+    // code that must not touch the heap after startup. A format needs at
+    // most 2 * (number of '{') + 1 items and no more literal characters than
+    // its length. items() is a non-owning view into this object.
+    //
+    // Format them with safe_format() (see safeformat.h) into a caller
+    // supplied buffer to get a formatting path that never allocates.
+    template<typename Char, std::size_t MaxItems, std::size_t MaxChars>
+    class BasicFixedFormatItems {
+    public:
+        typedef Char char_type;
+        typedef std::size_t size_type;
+
+        static const size_type max_items = MaxItems;
+        static const size_type max_chars = MaxChars;
+
+        inline BasicFixedFormatItems() noexcept : m_size(0) {}
+
+        // On errors the items are left empty.
+        inline FormatError parse(const Char* fmt, size_type size, size_type* error_pos = nullptr) noexcept {
+            return parse_format_into(fmt, size, m_items, MaxItems, m_literals, MaxChars, &m_size, error_pos);
+        }
+
+        inline FormatError parse(const Char* fmt) noexcept {
+            return parse(fmt, std::char_traits<Char>::length(fmt));
+        }
+
+        inline BasicFormatItems<Char> items() const noexcept {
+            return BasicFormatItems<Char>(m_items, m_size, m_literals);
+        }
+
+        inline size_type size() const noexcept { return m_size; }
+        inline bool empty()     const noexcept { return m_size == 0; }
+
+    private:
+        BasicFormatItem<Char> m_items[MaxItems];
+        Char                  m_literals[MaxChars];
+        size_type             m_size;
+    };
+
+    template<std::size_t MaxItems, std::size_t MaxChars>
+    using FixedFormatItems = BasicFixedFormatItems<char, MaxItems, MaxChars>;
+
+    template<std::size_t MaxItems, std::size_t MaxChars>
+    using WFixedFormatItems = BasicFixedFormatItems<wchar_t, MaxItems, MaxChars>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    template<std::size_t MaxItems, std::size_t MaxChars>
+    using U16FixedFormatItems = BasicFixedFormatItems<char16_t, MaxItems, MaxChars>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    template<std::size_t MaxItems, std::size_t MaxChars>
+    using U32FixedFormatItems = BasicFixedFormatItems<char32_t, MaxItems, MaxChars>;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template FORMATSTRING_EXPORT FormatError parse_format_into<char>(const char* fmt, std::size_t size, FormatItem* items, std::size_t capacity, char* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+    extern template FORMATSTRING_EXPORT FormatError parse_format_into<wchar_t>(const wchar_t* fmt, std::size_t size, WFormatItem* items, std::size_t capacity, wchar_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError parse_format_into<char16_t>(const char16_t* fmt, std::size_t size, U16FormatItem* items, std::size_t capacity, char16_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError parse_format_into<char32_t>(const char32_t* fmt, std::size_t size, U32FormatItem* items, std::size_t capacity, char32_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+#endif
+}
+
+#endif // FORMATSTRING_FIXEDFORMAT_H
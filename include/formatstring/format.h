@@ -3,14 +3,21 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <iosfwd>
 #include <sstream>
 
 #include "formatstring/config.h"
 #include "formatstring/export.h"
 
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+#   include <string_view>
+#endif
+
 #include "formatstring/formatter.h"
 #include "formatstring/formatitem.h"
+#include "formatstring/probes.h"
+#include "formatstring/scratch.h"
 
 namespace formatstring {
 
@@ -29,43 +36,202 @@ namespace formatstring {
 
     typedef BasicFormat<wchar_t> WFormat;
 
+    template<typename Char>
+    class BasicFormatRef;
+
+    typedef BasicFormatRef<char> FormatRef;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicFormatRef<char16_t> U16FormatRef;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicFormatRef<char32_t> U32FormatRef;
+#endif
+
+    typedef BasicFormatRef<wchar_t> WFormatRef;
+
     template<typename Char>
     class BasicBoundFormat;
 
+    // defined in formatstring/ownedformat.h
+    template<typename Char>
+    class BasicOwnedFormat;
+
     template<typename Char>
     BasicFormatItems<Char> parse_format(const Char* fmt);
 
+    template<typename Char>
+    BasicFormatItems<Char> parse_format(const Char* fmt, std::size_t size);
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char>
+    inline BasicFormatItems<Char> parse_format(std::basic_string_view<Char> fmt) {
+        return parse_format(fmt.data(), fmt.size());
+    }
+#endif
+
+    // Like parse_format(), but returns errors instead of throwing them. If
+    // error_pos isn't null it receives the position where parsing stopped.
+    // Only a failing allocation can still throw.
+    template<typename Char>
+    FormatError try_parse_format(const Char* fmt, std::size_t size, BasicFormatItems<Char>* items, std::size_t* error_pos = nullptr);
+
+    template<typename Char>
+    inline FormatError try_parse_format(const Char* fmt, BasicFormatItems<Char>* items, std::size_t* error_pos = nullptr) {
+        return try_parse_format(fmt, std::char_traits<Char>::length(fmt), items, error_pos);
+    }
+
+    // Like items.apply(), but returns errors instead of throwing them.
+    // Argument indices are checked before anything is written. A spec that
+    // doesn't apply to its argument's type is only noticed by the value
+    // formatter: with exceptions it is caught and reported as
+    // InvalidArgumentFormat, without them it goes to the error handler.
+    // The output is rendered into a scratch buffer first, so nothing is
+    // written to out on errors. Errors of out itself are not caught.
+    template<typename Char>
+    inline FormatError try_apply(const BasicFormatItems<Char>& items, std::basic_ostream<Char>& out, const BasicFormatters<Char>& formatters) {
+        for (const BasicFormatItem<Char>& item : items) {
+            if (item.kind == BasicFormatItem<Char>::Value && item.index >= formatters.size()) {
+                return ArgumentIndexOutOfRange;
+            }
+        }
+
+        BasicScratchBuffer<Char> buffer(out.getloc());
+#ifdef FORMATSTRING_EXCEPTIONS
+        try {
+            items.apply(buffer.stream(), formatters);
+        }
+        catch (const std::invalid_argument&) {
+            return InvalidArgumentFormat;
+        }
+#else
+        items.apply(buffer.stream(), formatters);
+#endif
+        out.write(buffer.data(), buffer.size());
+        return NoFormatError;
+    }
+
     template<typename Char>
     class FORMATSTRING_EXPORT BasicFormat {
     public:
         typedef Char char_type;
 
-        BasicFormat(const Char* fmt) : m_fmt(new BasicFormatItems<Char>(std::move(parse_format(fmt)))) {}
+        BasicFormat(const Char* fmt) : m_fmt(parse_format(fmt)) {}
+
+        BasicFormat(const Char* fmt, std::size_t size) : m_fmt(parse_format(fmt, size)) {}
+
+        BasicFormat(const std::basic_string<Char>& fmt) : BasicFormat(fmt.data(), fmt.size()) {}
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        // a member template, so the explicit instantiations in the C++14 built
+        // library don't have to provide it
+        template<typename Traits>
+        BasicFormat(std::basic_string_view<Char,Traits> fmt) : BasicFormat(fmt.data(), fmt.size()) {}
+#endif
+
+        explicit BasicFormat(BasicFormatItems<Char> items) : m_fmt(std::move(items)) {}
 
-        BasicFormat(const std::basic_string<Char>& fmt) : BasicFormat(fmt.c_str()) {}
         BasicFormat(const BasicFormat<Char>& other) : m_fmt(other.m_fmt) {}
 
+        BasicFormat(BasicFormat<Char>&& other) noexcept : m_fmt(std::move(other.m_fmt)) {}
+
+        BasicFormat<Char>& operator= (const BasicFormat<Char>& other) {
+            m_fmt = other.m_fmt;
+            return *this;
+        }
+
+        BasicFormat<Char>& operator= (BasicFormat<Char>&& other) noexcept {
+            m_fmt = std::move(other.m_fmt);
+            return *this;
+        }
+
         template<typename... Args>
         inline void format(std::basic_ostream<Char>& out, const Args&... args) const {
+            record_arg_kinds<Args...>(items());
             apply(out, {format_traits<Char,Args>::make_formatter(args)...});
         }
 
+        // non-owning view, see BasicFormatRef
+        inline BasicFormatRef<Char> ref() const noexcept;
+
         template<typename... Args>
         inline BasicBoundFormat<Char> bind(const Args&... args) const;
 
         template<typename... Args>
         inline BasicBoundFormat<Char> operator () (const Args&... args) const;
 
+        // copies the arguments, see formatstring/ownedformat.h
+        template<typename... Args>
+        inline BasicOwnedFormat<Char> bind_owned(const Args&... args) const;
+
+        // formats many argument records in parallel, see formatstring/batchformat.h
+        template<typename Record>
+        inline void format_batch(const Record* records, std::size_t count, std::basic_ostream<Char>& out, unsigned int threads = 0) const;
+
+        template<typename Record>
+        inline void format_batch(const std::vector<Record>& records, std::basic_ostream<Char>& out, unsigned int threads = 0) const;
+
         void apply(std::basic_ostream<Char>& out, const BasicFormatters<Char>& formatters) const {
-            for (auto& item : *m_fmt) {
-                item->apply(out, formatters);
-            }
+            m_fmt.apply(out, formatters);
         }
 
+        inline const BasicFormatItems<Char>& items() const { return m_fmt; }
+
     private:
-        std::shared_ptr<const BasicFormatItems<Char>> m_fmt;
+        BasicFormatItems<Char> m_fmt;
     };
 
+    // Refers to the items of a format without owning them. Binding arguments
+    // to a BasicFormat copies the format into the bound format, which touches
+    // the shared reference count of its items. Binding through a ref doesn't,
+    // so many threads can use one global format without contending on it.
+    // The referred format has to outlive the ref and everything bound to it.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicFormatRef {
+    public:
+        typedef Char char_type;
+
+        BasicFormatRef(const BasicFormat<Char>& format) noexcept : m_items(format.items().view()) {}
+
+        template<typename... Args>
+        inline void format(std::basic_ostream<Char>& out, const Args&... args) const {
+            record_arg_kinds<Args...>(items());
+            apply(out, {format_traits<Char,Args>::make_formatter(args)...});
+        }
+
+        template<typename... Args>
+        inline BasicBoundFormat<Char> bind(const Args&... args) const;
+
+        template<typename... Args>
+        inline BasicBoundFormat<Char> operator () (const Args&... args) const;
+
+        // copies the arguments, see formatstring/ownedformat.h
+        template<typename... Args>
+        inline BasicOwnedFormat<Char> bind_owned(const Args&... args) const;
+
+        // formats many argument records in parallel, see formatstring/batchformat.h
+        template<typename Record>
+        inline void format_batch(const Record* records, std::size_t count, std::basic_ostream<Char>& out, unsigned int threads = 0) const;
+
+        template<typename Record>
+        inline void format_batch(const std::vector<Record>& records, std::basic_ostream<Char>& out, unsigned int threads = 0) const;
+
+        void apply(std::basic_ostream<Char>& out, const BasicFormatters<Char>& formatters) const {
+            m_items.apply(out, formatters);
+        }
+
+        inline const BasicFormatItems<Char>& items() const { return m_items; }
+
+    private:
+        BasicFormatItems<Char> m_items;
+    };
+
+    template<typename Char>
+    inline BasicFormatRef<Char> BasicFormat<Char>::ref() const noexcept {
+        return BasicFormatRef<Char>(*this);
+    }
+
     template<typename Char>
     class FORMATSTRING_EXPORT BasicBoundFormat {
     public:
@@ -73,6 +239,7 @@ namespace formatstring {
 
     private:
         friend class BasicFormat<Char>;
+        friend class BasicFormatRef<Char>;
 
         template<typename _Char, typename... Args>
         friend BasicBoundFormat<_Char> format(const std::basic_string<_Char>& fmt, const Args&... args);
@@ -83,12 +250,22 @@ namespace formatstring {
         template<typename _Char, typename... Args>
         friend BasicBoundFormat<_Char> format(std::basic_string<_Char>&& fmt, Args&&... args);
 
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        template<typename _Char, typename... Args>
+        friend BasicBoundFormat<_Char> format(std::basic_string_view<_Char> fmt, const Args&... args);
+#endif
+
 #ifndef NDEBUG
         template<typename _Char, typename... Args>
         friend BasicBoundFormat<_Char> debug(const std::basic_string<_Char>& fmt, const Args&... args);
 
         template<typename _Char, typename... Args>
         friend BasicBoundFormat<_Char> debug(const _Char* fmt, const Args&... args);
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        template<typename _Char, typename... Args>
+        friend BasicBoundFormat<_Char> debug(std::basic_string_view<_Char> fmt, const Args&... args);
+#endif
 #endif
 
         BasicBoundFormat(BasicBoundFormat<Char>&& rhs) :
@@ -98,11 +275,25 @@ namespace formatstring {
 
         template<typename... Args>
         BasicBoundFormat(const BasicFormat<Char>& format, const Args&... args) :
-            m_format(format), m_formatters({format_traits<Char,Args>::make_formatter(args)...}) {}
+            m_format(format), m_formatters({format_traits<Char,Args>::make_formatter(args)...}) {
+            record_arg_kinds<Args...>(m_format.items());
+            FORMATSTRING_PROBE_BIND(m_format.items().begin(), sizeof...(Args));
+        }
 
         template<typename... Args>
         BasicBoundFormat(BasicFormat<Char>&& format, const Args&... args) :
-            m_format(std::move(format)), m_formatters({format_traits<Char,Args>::make_formatter(args)...}) {}
+            m_format(std::move(format)), m_formatters({format_traits<Char,Args>::make_formatter(args)...}) {
+            record_arg_kinds<Args...>(m_format.items());
+            FORMATSTRING_PROBE_BIND(m_format.items().begin(), sizeof...(Args));
+        }
+
+        // the items are only viewed, so this doesn't touch any reference count
+        template<typename... Args>
+        BasicBoundFormat(const BasicFormatRef<Char>& format, const Args&... args) :
+            m_format(format.items()), m_formatters({format_traits<Char,Args>::make_formatter(args)...}) {
+            record_arg_kinds<Args...>(m_format.items());
+            FORMATSTRING_PROBE_BIND(m_format.items().begin(), sizeof...(Args));
+        }
 
         BasicFormat<Char>& operator= (const BasicFormat<Char>& other) = delete;
 
@@ -112,9 +303,9 @@ namespace formatstring {
         }
 
         inline operator std::basic_string<Char> () const {
-            std::basic_ostringstream<Char> out;
-            m_format.apply(out, m_formatters);
-            return out.str();
+            BasicScratchBuffer<Char> buffer;
+            m_format.apply(buffer.stream(), m_formatters);
+            return buffer.str();
         }
 
         inline std::basic_string<Char> str() const {
@@ -122,13 +313,14 @@ namespace formatstring {
         }
 
     private:
-        const BasicFormat<Char> m_format;
-        const BasicFormatters<Char> m_formatters;
+        BasicFormat<Char> m_format;
+        BasicFormatters<Char> m_formatters;
     };
 
     template<typename Char>
     template<typename... Args>
     inline BasicBoundFormat<Char> BasicFormat<Char>::bind(const Args&... args) const {
+        FORMATSTRING_ALLOC_SCOPE(scope, items().begin(), BindPhase);
         return BasicBoundFormat<Char>(*this, args...);
     }
 
@@ -138,6 +330,19 @@ namespace formatstring {
         return bind(args...);
     }
 
+    template<typename Char>
+    template<typename... Args>
+    inline BasicBoundFormat<Char> BasicFormatRef<Char>::bind(const Args&... args) const {
+        FORMATSTRING_ALLOC_SCOPE(scope, items().begin(), BindPhase);
+        return BasicBoundFormat<Char>(*this, args...);
+    }
+
+    template<typename Char>
+    template<typename... Args>
+    inline BasicBoundFormat<Char> BasicFormatRef<Char>::operator () (const Args&... args) const {
+        return bind(args...);
+    }
+
     template<typename Char, typename OStream>
     inline OStream& operator << (OStream& out, const BasicBoundFormat<Char>& fmt) {
         fmt.write_into(out);
@@ -159,6 +364,13 @@ namespace formatstring {
         return BasicBoundFormat<Char>(std::move(fmt), std::forward<Args>(args)...);
     }
 
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char, typename... Args>
+    inline BasicBoundFormat<Char> format(std::basic_string_view<Char> fmt, const Args&... args) {
+        return BasicBoundFormat<Char>(BasicFormat<Char>(fmt), args...);
+    }
+#endif
+
     template<typename Char>
     inline BasicFormat<Char> compile(const std::basic_string<Char>& fmt) {
         return fmt;
@@ -169,6 +381,54 @@ namespace formatstring {
         return fmt;
     }
 
+    template<typename Char>
+    inline BasicFormat<Char> compile(const Char* fmt, std::size_t size) {
+        return BasicFormat<Char>(fmt, size);
+    }
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char>
+    inline BasicFormat<Char> compile(std::basic_string_view<Char> fmt) {
+        return fmt;
+    }
+#endif
+
+    // Like format() written to out, but reports errors as FormatError
+    // instead of throwing them. See try_parse_format() and try_apply().
+    template<typename Char, typename... Args>
+    inline FormatError try_format(std::basic_ostream<Char>& out, const BasicFormatRef<Char>& fmt, const Args&... args) {
+        record_arg_kinds<Args...>(fmt.items());
+        return try_apply(fmt.items(), out, {format_traits<Char,Args>::make_formatter(args)...});
+    }
+
+    template<typename Char, typename... Args>
+    inline FormatError try_format(std::basic_ostream<Char>& out, const BasicFormat<Char>& fmt, const Args&... args) {
+        record_arg_kinds<Args...>(fmt.items());
+        return try_apply(fmt.items(), out, {format_traits<Char,Args>::make_formatter(args)...});
+    }
+
+    template<typename Char, typename... Args>
+    inline FormatError try_format(std::basic_ostream<Char>& out, const Char* fmt, const Args&... args) {
+        BasicFormatItems<Char> items;
+        FormatError error = try_parse_format(fmt, &items);
+        if (error != NoFormatError) {
+            return error;
+        }
+        record_arg_kinds<Args...>(items);
+        return try_apply(items, out, {format_traits<Char,Args>::make_formatter(args)...});
+    }
+
+    template<typename Char, typename... Args>
+    inline FormatError try_format(std::basic_ostream<Char>& out, const std::basic_string<Char>& fmt, const Args&... args) {
+        BasicFormatItems<Char> items;
+        FormatError error = try_parse_format(fmt.c_str(), fmt.size(), &items);
+        if (error != NoFormatError) {
+            return error;
+        }
+        record_arg_kinds<Args...>(items);
+        return try_apply(items, out, {format_traits<Char,Args>::make_formatter(args)...});
+    }
+
     // ---- debug ----
     template<typename Char>
     class DummyBoundFormat;
@@ -180,8 +440,13 @@ namespace formatstring {
 
         inline DummyFormat() {}
         inline DummyFormat(const Char* fmt) { (void)fmt; }
+        inline DummyFormat(const Char* fmt, std::size_t size) { (void)fmt; (void)size; }
         inline DummyFormat(const std::basic_string<Char>& fmt) { (void)fmt; }
 
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        inline DummyFormat(std::basic_string_view<Char> fmt) { (void)fmt; }
+#endif
+
         template<typename... Args>
         inline void format(std::basic_ostream<Char>& out, const Args&...) const {
             (void)out;
@@ -274,6 +539,20 @@ namespace formatstring {
         (void)fmt;
         return DummyFormat<Char>();
     }
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char, typename... Args>
+    inline DummyBoundFormat<Char> debug(std::basic_string_view<Char> fmt, const Args&...) {
+        (void)fmt;
+        return DummyBoundFormat<Char>();
+    }
+
+    template<typename Char>
+    inline DummyFormat<Char> debug_compile(std::basic_string_view<Char> fmt) {
+        (void)fmt;
+        return DummyFormat<Char>();
+    }
+#endif
 #else
     template<typename Char, typename... Args>
     inline BasicBoundFormat<Char> debug(const std::basic_string<Char>& fmt, const Args&... args) {
@@ -299,60 +578,98 @@ namespace formatstring {
     inline BasicFormat<Char> debug_compile(const Char* fmt) {
         return fmt;
     }
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char, typename... Args>
+    inline BasicBoundFormat<Char> debug(std::basic_string_view<Char> fmt, const Args&... args) {
+        return BasicBoundFormat<Char>(BasicFormat<Char>(fmt), args...);
+    }
+
+    template<typename Char>
+    inline BasicFormat<Char> debug_compile(std::basic_string_view<Char> fmt) {
+        return fmt;
+    }
+#endif
 #endif
 
     extern template FORMATSTRING_EXPORT FormatItems parse_format<char>(const char* fmt);
+    extern template FORMATSTRING_EXPORT FormatItems parse_format<char>(const char* fmt, std::size_t size);
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
     extern template FORMATSTRING_EXPORT U16FormatItems parse_format<char16_t>(const char16_t* fmt);
+    extern template FORMATSTRING_EXPORT U16FormatItems parse_format<char16_t>(const char16_t* fmt, std::size_t size);
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
     extern template FORMATSTRING_EXPORT U32FormatItems parse_format<char32_t>(const char32_t* fmt);
+    extern template FORMATSTRING_EXPORT U32FormatItems parse_format<char32_t>(const char32_t* fmt, std::size_t size);
 #endif
 
     extern template FORMATSTRING_EXPORT WFormatItems parse_format<wchar_t>(const wchar_t* fmt);
+    extern template FORMATSTRING_EXPORT WFormatItems parse_format<wchar_t>(const wchar_t* fmt, std::size_t size);
+
+    extern template FORMATSTRING_EXPORT FormatError try_parse_format<char>(const char* fmt, std::size_t size, FormatItems* items, std::size_t* error_pos);
+    extern template FORMATSTRING_EXPORT FormatError try_parse_format<wchar_t>(const wchar_t* fmt, std::size_t size, WFormatItems* items, std::size_t* error_pos);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError try_parse_format<char16_t>(const char16_t* fmt, std::size_t size, U16FormatItems* items, std::size_t* error_pos);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError try_parse_format<char32_t>(const char32_t* fmt, std::size_t size, U32FormatItems* items, std::size_t* error_pos);
+#endif
 
     extern template class FORMATSTRING_EXPORT BasicFormat<char>;
+    extern template class FORMATSTRING_EXPORT BasicFormatRef<char>;
     extern template class FORMATSTRING_EXPORT BasicBoundFormat<char>;
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
     extern template class FORMATSTRING_EXPORT BasicFormat<char16_t>;
+    extern template class FORMATSTRING_EXPORT BasicFormatRef<char16_t>;
     extern template class FORMATSTRING_EXPORT BasicBoundFormat<char16_t>;
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
     extern template class FORMATSTRING_EXPORT BasicFormat<char32_t>;
+    extern template class FORMATSTRING_EXPORT BasicFormatRef<char32_t>;
     extern template class FORMATSTRING_EXPORT BasicBoundFormat<char32_t>;
 #endif
 
     extern template class FORMATSTRING_EXPORT BasicFormat<wchar_t>;
+    extern template class FORMATSTRING_EXPORT BasicFormatRef<wchar_t>;
     extern template class FORMATSTRING_EXPORT BasicBoundFormat<wchar_t>;
 
     // ---- literals ----
     inline Format operator "" _fmt (const char* fmt, std::size_t size) {
-        (void)size;
-        return fmt;
+        return Format(fmt, size);
     }
 
     inline WFormat operator "" _fmt (const wchar_t* fmt, std::size_t size) {
-        (void)size;
-        return fmt;
+        return WFormat(fmt, size);
     }
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
     inline U16Format operator "" _fmt (const char16_t* fmt, std::size_t size) {
-        (void)size;
-        return fmt;
+        return U16Format(fmt, size);
     }
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
     inline U32Format operator "" _fmt (const char32_t* fmt, std::size_t size) {
-        (void)size;
-        return fmt;
+        return U32Format(fmt, size);
     }
 #endif
 }
 
+// Compiles the format string literal fmt only once per call site, using
+// thread safe static initialization, and evaluates to a BasicFormatRef to
+// the cached format. Formatting in a hot loop then never parses:
+//
+//     out << FORMATSTRING_STATIC("x={} y={}")(x, y);
+#define FORMATSTRING_STATIC(fmt) \
+    ([]() { \
+        static const auto formatstring_static_format = ::formatstring::compile(fmt); \
+        return formatstring_static_format.ref(); \
+    }())
+
 #endif // FORMATSTRING_FORMAT_H
@@ -2,25 +2,229 @@
 #define FORMATSTRING_FORMATITEM_H
 #pragma once
 
+#include "formatstring/config.h"
+#include "formatstring/export.h"
 #include "formatstring/formatter.h"
+#include "formatstring/formatspec.h"
+#include "formatstring/conversion.h"
+#include "formatstring/exceptions.h"
+#include "formatstring/allocstats.h"
+#include "formatstring/formatstats.h"
+#include "formatstring/probes.h"
 
 #include <iosfwd>
-#include <vector>
-#include <memory>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+#ifdef FORMATSTRING_FORMAT_STATS
+#   define FORMATSTRING_ITEMS_STATS_INIT(stats) , m_stats(stats)
+#else
+#   define FORMATSTRING_ITEMS_STATS_INIT(stats)
+#endif
 
 namespace formatstring {
 
     template<typename Char>
-    class BasicFormatItem {
-    public:
+    struct BasicFormatItem {
         typedef Char char_type;
 
-        virtual ~BasicFormatItem() {}
-        virtual void apply(std::basic_ostream<Char>& out, const BasicFormatters<Char>& formatters) const = 0;
+        enum Kind {
+            Literal,
+            Value
+        };
+
+        Kind                  kind;
+        Conversion            conv;
+        std::size_t           index;  // Value: argument index
+        std::size_t           offset; // Literal: offset into the literal pool
+        std::size_t           length; // Literal: number of characters
+        BasicFormatSpec<Char> spec;
     };
 
+    // All items and the literal pool of a compiled format live in a single
+    // block of memory that is allocated once and shared by copies of the
+    // handle through an intrusive reference count. Handles that were created
+    // from external storage (view()) don't own anything.
     template<typename Char>
-    using BasicFormatItems = std::vector< std::unique_ptr< BasicFormatItem<Char> > >;
+    class FORMATSTRING_EXPORT BasicFormatItems {
+    public:
+        typedef Char char_type;
+        typedef BasicFormatItem<Char> value_type;
+        typedef const value_type* const_iterator;
+        typedef std::size_t size_type;
+
+        inline BasicFormatItems() noexcept :
+            m_block(nullptr), m_items(nullptr), m_size(0), m_literals(nullptr) FORMATSTRING_ITEMS_STATS_INIT(nullptr) {}
+
+        inline BasicFormatItems(const value_type* items, size_type size, const Char* literals) noexcept :
+            m_block(nullptr), m_items(const_cast<value_type*>(items)), m_size(size), m_literals(const_cast<Char*>(literals))
+            FORMATSTRING_ITEMS_STATS_INIT(nullptr) {}
+
+        inline BasicFormatItems(const BasicFormatItems<Char>& other) noexcept :
+            m_block(other.m_block), m_items(other.m_items), m_size(other.m_size), m_literals(other.m_literals)
+            FORMATSTRING_ITEMS_STATS_INIT(other.m_stats) {
+            if (m_block) {
+                m_block->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        inline BasicFormatItems(BasicFormatItems<Char>&& other) noexcept :
+            m_block(other.m_block), m_items(other.m_items), m_size(other.m_size), m_literals(other.m_literals)
+            FORMATSTRING_ITEMS_STATS_INIT(other.m_stats) {
+            other.m_block    = nullptr;
+            other.m_items    = nullptr;
+            other.m_size     = 0;
+            other.m_literals = nullptr;
+        }
+
+        inline ~BasicFormatItems() {
+            release();
+        }
+
+        inline BasicFormatItems<Char>& operator= (const BasicFormatItems<Char>& other) noexcept {
+            BasicFormatItems<Char> copy(other);
+            swap(copy);
+            return *this;
+        }
+
+        inline BasicFormatItems<Char>& operator= (BasicFormatItems<Char>&& other) noexcept {
+            BasicFormatItems<Char> moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
+
+        inline void swap(BasicFormatItems<Char>& other) noexcept {
+            std::swap(m_block, other.m_block);
+            std::swap(m_items, other.m_items);
+            std::swap(m_size, other.m_size);
+            std::swap(m_literals, other.m_literals);
+#ifdef FORMATSTRING_FORMAT_STATS
+            std::swap(m_stats, other.m_stats);
+#endif
+        }
+
+        // Allocates the single block for up to capacity items and chars literal characters.
+        static BasicFormatItems<Char> allocate(size_type capacity, size_type chars) {
+            std::size_t items_offset = align(sizeof(Block), alignof(value_type));
+            std::size_t chars_offset = items_offset + capacity * sizeof(value_type);
+            char* mem = static_cast<char*>(::operator new(chars_offset + chars * sizeof(Char)));
+
+            BasicFormatItems<Char> items;
+            items.m_block    = new (mem) Block();
+            items.m_items    = reinterpret_cast<value_type*>(mem + items_offset);
+            items.m_literals = reinterpret_cast<Char*>(mem + chars_offset);
+            return items;
+        }
+
+        // ---- building, only valid on a freshly allocated block ----
+        void push_literal(const Char* str, size_type length) {
+            size_type& chars = m_block->chars;
+            std::char_traits<Char>::copy(m_literals + chars, str, length);
+            if (m_size > 0 && m_items[m_size - 1].kind == value_type::Literal) {
+                m_items[m_size - 1].length += length;
+            }
+            else {
+                value_type* item = new (m_items + m_size) value_type();
+                item->kind   = value_type::Literal;
+                item->conv   = NoConv;
+                item->index  = 0;
+                item->offset = chars;
+                item->length = length;
+                ++ m_size;
+            }
+            chars += length;
+        }
+
+        void push_value(size_type index, Conversion conv, const BasicFormatSpec<Char>& spec) {
+            value_type* item = new (m_items + m_size) value_type();
+            item->kind   = value_type::Value;
+            item->conv   = conv;
+            item->index  = index;
+            item->offset = 0;
+            item->length = 0;
+            item->spec   = spec;
+            ++ m_size;
+        }
+
+        // ---- access ----
+        inline const_iterator begin() const noexcept { return m_items; }
+        inline const_iterator end()   const noexcept { return m_items + m_size; }
+        inline size_type size()       const noexcept { return m_size; }
+        inline bool empty()           const noexcept { return m_size == 0; }
+
+        inline const value_type& operator[] (size_type index) const noexcept { return m_items[index]; }
+
+        inline const Char* literals() const noexcept { return m_literals; }
+        inline const Char* literal(const value_type& item) const noexcept { return m_literals + item.offset; }
+
+        // A handle to the same storage that doesn't take part in the reference counting.
+        inline BasicFormatItems<Char> view() const noexcept {
+            BasicFormatItems<Char> items(m_items, m_size, m_literals);
+#ifdef FORMATSTRING_FORMAT_STATS
+            items.m_stats = m_stats;
+#endif
+            return items;
+        }
+
+#ifdef FORMATSTRING_FORMAT_STATS
+        // runtime statistics shared by all formats of the same format string,
+        // null for formats that weren't compiled by parse_format()
+        inline FormatStats* stats() const noexcept { return m_stats; }
+        inline void set_stats(FormatStats* stats) noexcept { m_stats = stats; }
+#endif
+
+        void apply(std::basic_ostream<Char>& out, const BasicFormatters<Char>& formatters) const {
+            FORMATSTRING_ALLOC_SCOPE(scope, m_items, ApplyPhase);
+#ifdef FORMATSTRING_FORMAT_STATS
+            BasicFormatStatsScope<Char> stats_scope(m_stats, out);
+#endif
+#ifdef FORMATSTRING_USDT
+            BasicApplyProbe<Char> probe(m_items, out);
+#endif
+            for (const value_type& item : *this) {
+                if (item.kind == value_type::Literal) {
+                    out.write(m_literals + item.offset, item.length);
+                }
+                else {
+                    if (item.index >= formatters.size()) {
+                        FORMATSTRING_THROW(InvalidFormatArgumentException(item.index));
+                    }
+                    formatters[item.index](out, item.conv, item.spec);
+                }
+            }
+        }
+
+    private:
+        struct Block {
+            std::atomic<std::size_t> refs;
+            size_type                chars; // used literal pool while building
+
+            Block() : refs(1), chars(0) {}
+        };
+
+        static inline std::size_t align(std::size_t offset, std::size_t alignment) noexcept {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+
+        inline void release() noexcept {
+            // items and the spec inside them are trivially destructible
+            if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                m_block->~Block();
+                ::operator delete(m_block);
+            }
+            m_block = nullptr;
+        }
+
+        Block*      m_block;
+        value_type* m_items;
+        size_type   m_size;
+        Char*       m_literals;
+#ifdef FORMATSTRING_FORMAT_STATS
+        FormatStats* m_stats;
+#endif
+    };
 
     typedef BasicFormatItem<char> FormatItem;
     typedef BasicFormatItem<wchar_t> WFormatItem;
@@ -36,6 +240,18 @@ namespace formatstring {
     typedef BasicFormatItem<char32_t> U32FormatItem;
     typedef BasicFormatItems<char32_t> U32FormatItems;
 #endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicFormatItems<char>;
+    extern template class FORMATSTRING_EXPORT BasicFormatItems<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicFormatItems<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicFormatItems<char32_t>;
+#endif
 }
 
 #endif // FORMATSTRING_FORMATITEM_H
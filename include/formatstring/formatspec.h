@@ -4,10 +4,15 @@
 
 #include "formatstring/config.h"
 #include "formatstring/export.h"
+#include "formatstring/exceptions.h"
 
 #include <cstdint>
 #include <string>
 
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+#   include <string_view>
+#endif
+
 namespace formatstring {
 
     template<typename Char>
@@ -28,6 +33,23 @@ namespace formatstring {
     template<typename Char>
     BasicFormatSpec<Char> parse_spec(const Char* str);
 
+    template<typename Char>
+    BasicFormatSpec<Char> parse_spec(const Char* str, std::size_t size);
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char>
+    inline BasicFormatSpec<Char> parse_spec(std::basic_string_view<Char> str) {
+        return parse_spec(str.data(), str.size());
+    }
+#endif
+
+    // Like parse_spec(), but reports errors instead of throwing them and
+    // doesn't allocate, so it can even be used in signal handlers. If
+    // parsed isn't null it receives the number of characters that belong
+    // to the spec.
+    template<typename Char>
+    FormatError try_parse_spec(const Char* str, std::size_t size, BasicFormatSpec<Char>* spec, std::size_t* parsed = nullptr) noexcept;
+
     template<typename Char>
     struct FORMATSTRING_EXPORT BasicFormatSpec {
         typedef Char char_type;
@@ -87,7 +109,16 @@ namespace formatstring {
 
         inline BasicFormatSpec(const char_type* spec) : BasicFormatSpec(std::move(parse_spec(spec))) {}
 
-        inline BasicFormatSpec(const std::basic_string<char_type>& spec) : BasicFormatSpec(spec.c_str()) {}
+        inline BasicFormatSpec(const char_type* spec, std::size_t size) : BasicFormatSpec(std::move(parse_spec(spec, size))) {}
+
+        inline BasicFormatSpec(const std::basic_string<char_type>& spec) : BasicFormatSpec(spec.data(), spec.size()) {}
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        // templates: the library is built as C++14, its explicit
+        // instantiations can't contain string_view members
+        template<typename Traits>
+        inline BasicFormatSpec(std::basic_string_view<char_type,Traits> spec) : BasicFormatSpec(spec.data(), spec.size()) {}
+#endif
 
         BasicFormatSpec(const self_type& other) = default;
 
@@ -107,9 +138,17 @@ namespace formatstring {
         self_type& operator= (const self_type& other) = default;
 
         inline self_type& operator= (const std::basic_string<Char>& spec) {
-            *this = parse_spec(spec.c_str());
+            *this = parse_spec(spec.data(), spec.size());
+            return *this;
+        }
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        template<typename Traits>
+        inline self_type& operator= (std::basic_string_view<Char,Traits> spec) {
+            *this = parse_spec(spec.data(), spec.size());
             return *this;
         }
+#endif
 
         inline self_type& operator= (const Char* spec) {
             *this = parse_spec(spec);
@@ -195,16 +234,31 @@ namespace formatstring {
 
     // ---- extern template instantiations ----
     extern template FORMATSTRING_EXPORT FormatSpec parse_spec<char>(const char* str);
+    extern template FORMATSTRING_EXPORT FormatSpec parse_spec<char>(const char* str, std::size_t size);
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
     extern template FORMATSTRING_EXPORT U16FormatSpec parse_spec<char16_t>(const char16_t* str);
+    extern template FORMATSTRING_EXPORT U16FormatSpec parse_spec<char16_t>(const char16_t* str, std::size_t size);
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
     extern template FORMATSTRING_EXPORT U32FormatSpec parse_spec<char32_t>(const char32_t* str);
+    extern template FORMATSTRING_EXPORT U32FormatSpec parse_spec<char32_t>(const char32_t* str, std::size_t size);
 #endif
 
     extern template FORMATSTRING_EXPORT WFormatSpec parse_spec<wchar_t>(const wchar_t* str);
+    extern template FORMATSTRING_EXPORT WFormatSpec parse_spec<wchar_t>(const wchar_t* str, std::size_t size);
+
+    extern template FORMATSTRING_EXPORT FormatError try_parse_spec<char>(const char* str, std::size_t size, FormatSpec* spec, std::size_t* parsed) noexcept;
+    extern template FORMATSTRING_EXPORT FormatError try_parse_spec<wchar_t>(const wchar_t* str, std::size_t size, WFormatSpec* spec, std::size_t* parsed) noexcept;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError try_parse_spec<char16_t>(const char16_t* str, std::size_t size, U16FormatSpec* spec, std::size_t* parsed) noexcept;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT FormatError try_parse_spec<char32_t>(const char32_t* str, std::size_t size, U32FormatSpec* spec, std::size_t* parsed) noexcept;
+#endif
 
     extern template class FORMATSTRING_EXPORT BasicFormatSpec<char>;
     extern template class FORMATSTRING_EXPORT BasicFormatSpec<wchar_t>;
@@ -0,0 +1,193 @@
+#ifndef FORMATSTRING_FORMATSTATS_H
+#define FORMATSTRING_FORMATSTATS_H
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+#   include <string_view>
+#endif
+
+// Runtime statistics per format, compiled in with WITH_FORMAT_STATS=ON.
+// Every format compiled by parse_format() gets counters for how often it
+// was applied, how much output that produced, how long it took and which
+// kinds of arguments were bound to it. Formats with the same format string
+// share their counters, so format("...", args) called over and over again
+// accumulates into one entry.
+//
+// Counters are updated with relaxed atomics from any thread. The output
+// size is only measured for output to memory (string streams and the
+// library's scratch buffers), asking a file stream or std::cout for its
+// position would flush or seek it. The number of applies where it was
+// measured is counted separately.
+//
+// Up to 4096 format strings get counters of their own, all later ones
+// share a single entry labeled "(other formats)". Each thread caches the
+// counters of recently parsed format strings by their address, so parsing
+// a format string again usually takes no lock.
+
+namespace formatstring {
+
+    enum ArgKind {
+        BoolArg,
+        CharArg,
+        IntegerArg,
+        FloatArg,
+        StringArg,
+        PointerArg,
+        OtherArg, // containers, tuples and user types
+
+        ArgKindCount
+    };
+
+    namespace impl {
+        template<typename T> struct is_char_type : std::false_type {};
+        template<> struct is_char_type<char>     : std::true_type {};
+        template<> struct is_char_type<wchar_t>  : std::true_type {};
+        template<> struct is_char_type<char16_t> : std::true_type {};
+        template<> struct is_char_type<char32_t> : std::true_type {};
+
+        template<typename T> struct is_string_type : std::false_type {};
+
+        template<typename Char, typename Traits, typename Alloc>
+        struct is_string_type< std::basic_string<Char,Traits,Alloc> > : std::true_type {};
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+        template<typename Char, typename Traits>
+        struct is_string_type< std::basic_string_view<Char,Traits> > : std::true_type {};
+#endif
+
+        template<typename T>
+        struct arg_kind {
+            // arrays decay, so char arrays count as strings
+            typedef typename std::remove_cv<typename std::decay<T>::type>::type type;
+            typedef typename std::remove_cv<typename std::remove_pointer<type>::type>::type pointee;
+
+            static const ArgKind value =
+                std::is_same<type, bool>::value ? BoolArg :
+                is_char_type<type>::value ? CharArg :
+                std::is_integral<type>::value ? IntegerArg :
+                std::is_floating_point<type>::value ? FloatArg :
+                is_string_type<type>::value ? StringArg :
+                std::is_pointer<type>::value && is_char_type<pointee>::value ? StringArg :
+                std::is_pointer<type>::value || std::is_same<type, std::nullptr_t>::value ? PointerArg :
+                OtherArg;
+        };
+    }
+
+    FORMATSTRING_EXPORT const char* arg_kind_name(ArgKind kind) noexcept;
+}
+
+#ifdef FORMATSTRING_FORMAT_STATS
+
+#include <iosfwd>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace formatstring {
+
+    struct FORMATSTRING_EXPORT FormatStats {
+        std::atomic<std::uint64_t> applies;
+        std::atomic<std::uint64_t> measured; // applies with a known output size
+        std::atomic<std::uint64_t> bytes;
+        std::atomic<std::uint64_t> nanos;
+        std::atomic<std::uint64_t> max_nanos;
+        std::atomic<std::uint64_t> args[ArgKindCount];
+
+        FormatStats() noexcept;
+
+        FormatStats(const FormatStats& other) = delete;
+        FormatStats& operator= (const FormatStats& other) = delete;
+
+        void reset() noexcept;
+    };
+
+    struct FormatStatsSnapshot {
+        std::string   label; // the format string, non-ASCII characters as '?'
+        std::uint64_t applies;
+        std::uint64_t measured;
+        std::uint64_t bytes;
+        std::uint64_t nanos;
+        std::uint64_t max_nanos;
+        std::uint64_t args[ArgKindCount];
+    };
+
+    enum FormatStatsDump {
+        TextDump,
+        PrometheusDump // text exposition format, e.g. for node_exporter's textfile collector
+    };
+
+    // The counters of the format string fmt of size characters of
+    // char_size bytes, created on first use. They are never freed, see
+    // above for the limit.
+    FORMATSTRING_EXPORT FormatStats* register_format_stats(const void* fmt, std::size_t size, std::size_t char_size);
+
+    // Times an apply and measures its output, see BasicFormatItems::apply().
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicFormatStatsScope {
+    public:
+        BasicFormatStatsScope(FormatStats* stats, std::basic_ostream<Char>& out);
+        ~BasicFormatStatsScope();
+
+        BasicFormatStatsScope(const BasicFormatStatsScope<Char>& other) = delete;
+        BasicFormatStatsScope<Char>& operator= (const BasicFormatStatsScope<Char>& other) = delete;
+
+    private:
+        FormatStats*                          m_stats;
+        std::basic_ostream<Char>*             m_out;
+        std::int64_t                          m_pos;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    template<typename... Args, typename Items>
+    inline void record_arg_kinds(const Items& items) noexcept {
+        FormatStats* stats = items.stats();
+        if (stats) {
+            const ArgKind kinds[] = {impl::arg_kind<Args>::value..., OtherArg};
+            for (std::size_t index = 0; index < sizeof...(Args); ++ index) {
+                stats->args[kinds[index]].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // ordered by the time spent in total
+    FORMATSTRING_EXPORT std::vector<FormatStatsSnapshot> format_stats();
+    FORMATSTRING_EXPORT void reset_format_stats() noexcept;
+
+    FORMATSTRING_EXPORT void dump_format_stats(std::ostream& out, FormatStatsDump kind = TextDump);
+
+    // Writes to a temporary file next to path and renames it, so readers
+    // never see a partial dump. Throws std::runtime_error on errors.
+    FORMATSTRING_EXPORT void write_format_stats(const std::string& path, FormatStatsDump kind = PrometheusDump);
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicFormatStatsScope<char>;
+    extern template class FORMATSTRING_EXPORT BasicFormatStatsScope<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicFormatStatsScope<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicFormatStatsScope<char32_t>;
+#endif
+}
+
+#else
+
+namespace formatstring {
+
+    template<typename... Args, typename Items>
+    inline void record_arg_kinds(const Items&) noexcept {}
+}
+
+#endif // FORMATSTRING_FORMAT_STATS
+
+#endif // FORMATSTRING_FORMATSTATS_H
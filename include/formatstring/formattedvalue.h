@@ -9,6 +9,7 @@
 #include "formatstring/formatspec.h"
 #include "formatstring/formatvalue.h"
 #include "formatstring/format_traits.h"
+#include "formatstring/scratch.h"
 
 #include <sstream>
 
@@ -51,9 +52,9 @@ namespace formatstring {
         }
 
         inline operator std::basic_string<Char> () const {
-            std::basic_ostringstream<Char> out;
-            format(out);
-            return out.str();
+            BasicScratchBuffer<Char> buffer;
+            format(buffer.stream());
+            return buffer.str();
         }
 
         inline self_type& align(typename spec_type::Alignment alignment) noexcept {
@@ -44,16 +44,16 @@ namespace formatstring {
             switch (conv) {
             case ReprConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _repr(buffer, value);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _repr(buffer.stream(), value);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             case StrConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _format(buffer, value, BasicFormatSpec<Char>::DEFAULT);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _format(buffer.stream(), value, BasicFormatSpec<Char>::DEFAULT);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             default:
@@ -71,16 +71,16 @@ namespace formatstring {
             switch (conv) {
             case ReprConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _repr(buffer, *ptr);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _repr(buffer.stream(), *ptr);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             case StrConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _format(buffer, *ptr, BasicFormatSpec<Char>::DEFAULT);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _format(buffer.stream(), *ptr, BasicFormatSpec<Char>::DEFAULT);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             default:
@@ -90,6 +90,21 @@ namespace formatstring {
         };
     }
 
+    // formats length characters at value, which may contain NULs
+    template<typename Char>
+    BasicFormatter<Char> make_string_formatter(const Char* value, std::size_t length) {
+        return [value, length](std::basic_ostream<Char>& out, Conversion conv, const BasicFormatSpec<Char>& spec) {
+            if (conv == ReprConv) {
+                BasicScratchBuffer<Char> buffer;
+                repr_string(buffer.stream(), value, length);
+                format_string(out, buffer.data(), buffer.size(), spec);
+            }
+            else {
+                format_string(out, value, length, spec);
+            }
+        };
+    }
+
     template<typename Char, typename T>
     inline BasicFormatter<Char> make_fallback_formatter(const T* ptr) {
         return make_ptr_formatter<Char,T,const T*,format_value_fallback,repr_value_fallback>(ptr);
@@ -103,16 +118,16 @@ namespace formatstring {
             switch (conv) {
             case ReprConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _repr(buffer, begin, end, left, right);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _repr(buffer.stream(), begin, end, left, right);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             case StrConv:
             {
-                std::basic_ostringstream<Char> buffer;
-                _format(buffer, begin, end, BasicFormatSpec<Char>::DEFAULT, left, right);
-                format_value(out, buffer.str(), spec);
+                BasicScratchBuffer<Char> buffer;
+                _format(buffer.stream(), begin, end, BasicFormatSpec<Char>::DEFAULT, left, right);
+                format_string(out, buffer.data(), buffer.size(), spec);
                 break;
             }
             default:
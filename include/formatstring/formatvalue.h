@@ -15,6 +15,7 @@
 #include "formatstring/config.h"
 #include "formatstring/export.h"
 #include "formatstring/formatspec.h"
+#include "formatstring/scratch.h"
 
 namespace formatstring {
 
@@ -74,6 +75,7 @@ namespace formatstring {
     void format_float(std::basic_ostream<Char>& out, Float value, const BasicFormatSpec<Char>& spec);
 
     template<typename Char> void format_string(std::basic_ostream<Char>& out, const Char value[], const BasicFormatSpec<Char>& spec);
+    template<typename Char> void format_string(std::basic_ostream<Char>& out, const Char value[], std::size_t length, const BasicFormatSpec<Char>& spec);
 
     template<typename Char> inline void format_value(std::basic_ostream<Char>& out, bool value, const BasicFormatSpec<Char>& spec);
 
@@ -132,6 +134,9 @@ namespace formatstring {
     template<typename Char>
     void format_string(std::basic_ostream<Char>& out, const Char value[], const BasicFormatSpec<Char>& spec);
 
+    template<typename Char>
+    void format_string(std::basic_ostream<Char>& out, const Char value[], std::size_t length, const BasicFormatSpec<Char>& spec);
+
     template<typename Char>
     void repr_char(std::basic_ostream<Char>& out, Char value);
 
@@ -141,6 +146,9 @@ namespace formatstring {
     template<typename Char>
     void repr_string(std::basic_ostream<Char>& out, const Char* value);
 
+    template<typename Char>
+    void repr_string(std::basic_ostream<Char>& out, const Char* value, std::size_t length);
+
     // ---- format_value impl ----
     template<typename Char, typename CharValue>
     inline void format_char(std::basic_ostream<Char>& out, CharValue value, const BasicFormatSpec<Char>& spec) {
@@ -182,7 +190,7 @@ namespace formatstring {
     template<typename Char> inline void format_value(std::basic_ostream<Char>& out, double value, const BasicFormatSpec<Char>& spec) { format_float(out, value, spec); }
     template<typename Char> inline void format_value(std::basic_ostream<Char>& out, long double value, const BasicFormatSpec<Char>& spec) { format_float(out, value, spec); }
 
-    template<typename Char> inline void format_value(std::basic_ostream<Char>& out, const std::basic_string<Char>& str, const BasicFormatSpec<Char>& spec) { format_string(out, str.c_str(), spec); }
+    template<typename Char> inline void format_value(std::basic_ostream<Char>& out, const std::basic_string<Char>& str, const BasicFormatSpec<Char>& spec) { format_string(out, str.data(), str.size(), spec); }
     template<typename Char> inline void format_value(std::basic_ostream<Char>& out, const Char* str, const BasicFormatSpec<Char>& spec) { format_string(out, str, spec); }
 
     // --- repr_value impl ----
@@ -217,7 +225,7 @@ namespace formatstring {
     template<typename Char> inline void repr_value(std::basic_ostream<Char>& out, double value) { out << value; }
     template<typename Char> inline void repr_value(std::basic_ostream<Char>& out, long double value) { out << value; }
 
-    template<typename Char> void repr_value(std::basic_ostream<Char>& out, const std::basic_string<Char>& value) { repr_string(out, value.c_str()); }
+    template<typename Char> void repr_value(std::basic_ostream<Char>& out, const std::basic_string<Char>& value) { repr_string(out, value.data(), value.size()); }
     template<typename Char> void repr_value(std::basic_ostream<Char>& out, const Char* value) { repr_string(out, value); }
 
     namespace impl {
@@ -266,45 +274,45 @@ namespace formatstring {
 
     template<typename Char, typename... Args>
     void format_value(std::basic_ostream<Char>& out, const std::tuple<Args...>& value, const BasicFormatSpec<Char>& spec) {
-        std::basic_ostringstream<Char> buffer;
+        BasicScratchBuffer<Char> buffer;
 
-        repr_value(buffer, value);
+        repr_value(buffer.stream(), value);
 
-        format_value(out, buffer.str(), spec);
+        format_string(out, buffer.data(), buffer.size(), spec);
     }
 
     template<typename Char, typename First, typename Second>
     void format_value(std::basic_ostream<Char>& out, const std::pair<First,Second>& value, const FormatSpec& spec) {
-        std::basic_ostringstream<Char> buffer;
+        BasicScratchBuffer<Char> buffer;
 
-        repr_value(buffer, value);
+        repr_value(buffer.stream(), value);
 
-        format_value(out, buffer.str(), spec);
+        format_string(out, buffer.data(), buffer.size(), spec);
     }
 
     template<typename Char, typename Iter>
     void format_slice(std::basic_ostream<Char>& out, Iter begin, Iter end, const BasicFormatSpec<Char>& spec, Char left = '[', Char right = ']') {
-        std::basic_ostringstream<Char> buffer;
+        BasicScratchBuffer<Char> buffer;
 
-        repr_slice(buffer, begin, end, left, right);
+        repr_slice(buffer.stream(), begin, end, left, right);
 
-        format_value(out, buffer.str(), spec);
+        format_string(out, buffer.data(), buffer.size(), spec);
     }
 
     template<typename Char, typename Iter>
     void format_map(std::basic_ostream<Char>& out, Iter begin, Iter end, const BasicFormatSpec<Char>& spec, Char left = '{', Char right = '}') {
-        std::basic_ostringstream<Char> buffer;
+        BasicScratchBuffer<Char> buffer;
 
-        repr_map(buffer, begin, end, left, right);
+        repr_map(buffer.stream(), begin, end, left, right);
 
-        format_value(out, buffer.str(), spec);
+        format_string(out, buffer.data(), buffer.size(), spec);
     }
 
     template<typename Char, typename T>
     void format_value_fallback(std::basic_ostream<Char>& out, const T& value, const BasicFormatSpec<Char>& spec) {
-        std::basic_ostringstream<Char> buffer;
-        buffer << value;
-        format_value(out, buffer.str(), spec);
+        BasicScratchBuffer<Char> buffer;
+        buffer.stream() << value;
+        format_string(out, buffer.data(), buffer.size(), spec);
     }
 
     // --- repr_value for complex types ----
@@ -377,7 +385,9 @@ namespace formatstring {
     extern template FORMATSTRING_EXPORT void repr_char<wchar_t>(std::wostream& out, wchar_t value);
 
     extern template FORMATSTRING_EXPORT void repr_string<char>(std::ostream& out, const char* value);
+    extern template FORMATSTRING_EXPORT void repr_string<char>(std::ostream& out, const char* value, std::size_t length);
     extern template FORMATSTRING_EXPORT void repr_string<wchar_t>(std::wostream& out, const wchar_t* value);
+    extern template FORMATSTRING_EXPORT void repr_string<wchar_t>(std::wostream& out, const wchar_t* value, std::size_t length);
 
     extern template FORMATSTRING_EXPORT void format_bool<char>(std::ostream& out, bool value, const FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_bool<wchar_t>(std::wostream& out, bool value, const WFormatSpec& spec);
@@ -386,7 +396,9 @@ namespace formatstring {
     extern template FORMATSTRING_EXPORT void format_int_char<wchar_t>(std::wostream& out, std::char_traits<wchar_t>::int_type value, const WFormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_string<char>(std::ostream& out, const char value[], const FormatSpec& spec);
+    extern template FORMATSTRING_EXPORT void format_string<char>(std::ostream& out, const char value[], std::size_t length, const FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_string<wchar_t>(std::wostream& out, const wchar_t value[], const WFormatSpec& spec);
+    extern template FORMATSTRING_EXPORT void format_string<wchar_t>(std::wostream& out, const wchar_t value[], std::size_t length, const WFormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_float<char,float>(std::ostream& out, float value, const FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_float<wchar_t,float>(std::wostream& out, float value, const WFormatSpec& spec);
@@ -429,11 +441,13 @@ namespace formatstring {
     extern template FORMATSTRING_EXPORT void repr_bool<char16_t>(std::basic_ostream<char16_t>& out, bool value);
     extern template FORMATSTRING_EXPORT void repr_char<char16_t>(std::basic_ostream<char16_t>& out, char16_t value);
     extern template FORMATSTRING_EXPORT void repr_string<char16_t>(std::basic_stream<char16_t>& out, const char16_t* value);
+    extern template FORMATSTRING_EXPORT void repr_string<char16_t>(std::basic_stream<char16_t>& out, const char16_t* value, std::size_t length);
 
     extern template FORMATSTRING_EXPORT void format_bool<char16_t>(std::basic_stream<char16_t>& out, bool value, const U16FormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_int_char<char16_t>(std::basic_ostream<char16_t>& out, std::char_traits<char16_t>::int_type value, const U16FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_string<char16_t>(std::basic_ostream<char16_t>& out, const char16_t value[], const U16FormatSpec& spec);
+    extern template FORMATSTRING_EXPORT void format_string<char16_t>(std::basic_ostream<char16_t>& out, const char16_t value[], std::size_t length, const U16FormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_float<char16_t,float>(std::basic_ostream<char16_t>& out, float value, const U16FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_float<char16_t,double>(std::basic_ostream<char16_t>& out, double value, const U16FormatSpec& spec);
@@ -459,11 +473,13 @@ namespace formatstring {
     extern template FORMATSTRING_EXPORT void repr_bool<char32_t>(std::basic_ostream<char32_t>& out, bool value);
     extern template FORMATSTRING_EXPORT void repr_char<char32_t>(std::basic_ostream<char32_t>& out, char32_t value);
     extern template FORMATSTRING_EXPORT void repr_string<char32_t>(std::basic_stream<char32_t>& out, const char32_t* value);
+    extern template FORMATSTRING_EXPORT void repr_string<char32_t>(std::basic_stream<char32_t>& out, const char32_t* value, std::size_t length);
 
     extern template FORMATSTRING_EXPORT void format_bool<char32_t>(std::basic_stream<char32_t>& out, bool value, const U32FormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_int_char<char32_t>(std::basic_ostream<char32_t>& out, std::char_traits<char32_t>::int_type value, const U32FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_string<char32_t>(std::basic_ostream<char32_t>& out, const char32_t value[], const U32FormatSpec& spec);
+    extern template FORMATSTRING_EXPORT void format_string<char32_t>(std::basic_ostream<char32_t>& out, const char32_t value[], std::size_t length, const U32FormatSpec& spec);
 
     extern template FORMATSTRING_EXPORT void format_float<char32_t,float>(std::basic_ostream<char32_t>& out, float value, const U32FormatSpec& spec);
     extern template FORMATSTRING_EXPORT void format_float<char32_t,double>(std::basic_ostream<char32_t>& out, double value, const U32FormatSpec& spec);
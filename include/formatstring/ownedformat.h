@@ -0,0 +1,286 @@
+#ifndef FORMATSTRING_OWNEDFORMAT_H
+#define FORMATSTRING_OWNEDFORMAT_H
+#pragma once
+
+#include <string>
+#include <array>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/format_traits.h"
+
+namespace formatstring {
+
+    // ---- how arguments are stored in an owned record ----
+    // size() and alignment give the space a value needs, store() copies it
+    // into the record and make_formatter() creates a formatter for the copy.
+    template<typename Char, typename T, typename ENABLE = void>
+    struct owned_traits {
+        typedef T stored_type;
+
+        static const std::size_t alignment = alignof(T);
+
+        static inline std::size_t size(const T&) { return sizeof(T); }
+
+        static inline void store(void* mem, const T& value) {
+            new (mem) T(value);
+        }
+
+        static inline BasicFormatter<Char> make_formatter(const void* mem) {
+            return format_traits<Char,T>::make_formatter(*static_cast<const T*>(mem));
+        }
+    };
+
+    // strings are copied inline after their length, so they may contain NULs
+    template<typename Char>
+    struct owned_string_traits {
+        typedef Char stored_type;
+
+        static const std::size_t alignment = alignof(std::size_t) > alignof(Char) ? alignof(std::size_t) : alignof(Char);
+
+        static inline std::size_t size(const Char* str, std::size_t length) {
+            (void)str;
+            return sizeof(std::size_t) + length * sizeof(Char);
+        }
+
+        static inline void store(void* mem, const Char* str, std::size_t length) {
+            *static_cast<std::size_t*>(mem) = length;
+            std::char_traits<Char>::copy(chars(mem), str, length);
+        }
+
+        static inline BasicFormatter<Char> make_formatter(const void* mem) {
+            return make_string_formatter<Char>(chars(const_cast<void*>(mem)), *static_cast<const std::size_t*>(mem));
+        }
+
+    private:
+        static inline Char* chars(void* mem) {
+            return reinterpret_cast<Char*>(static_cast<std::size_t*>(mem) + 1);
+        }
+    };
+
+    template<typename Char>
+    struct owned_traits<Char, const Char*> : public owned_string_traits<Char> {
+        static inline std::size_t size(const Char* value) { return owned_string_traits<Char>::size(value, std::char_traits<Char>::length(value)); }
+        static inline void store(void* mem, const Char* value) { owned_string_traits<Char>::store(mem, value, std::char_traits<Char>::length(value)); }
+    };
+
+    template<typename Char>
+    struct owned_traits<Char, Char*> : public owned_traits<Char, const Char*> {};
+
+    template<typename Char, std::size_t N>
+    struct owned_traits<Char, const Char[N]> : public owned_traits<Char, const Char*> {};
+
+    template<typename Char, std::size_t N>
+    struct owned_traits<Char, Char[N]> : public owned_traits<Char, const Char*> {};
+
+    template<typename Char>
+    struct owned_traits< Char, std::basic_string<Char> > : public owned_string_traits<Char> {
+        static inline std::size_t size(const std::basic_string<Char>& value) { return owned_string_traits<Char>::size(value.data(), value.size()); }
+        static inline void store(void* mem, const std::basic_string<Char>& value) { owned_string_traits<Char>::store(mem, value.data(), value.size()); }
+    };
+
+#ifdef FORMATSTRING_STRING_VIEW_SUPPORT
+    template<typename Char>
+    struct owned_traits< Char, std::basic_string_view<Char> > : public owned_string_traits<Char> {
+        static inline std::size_t size(std::basic_string_view<Char> value) { return owned_string_traits<Char>::size(value.data(), value.size()); }
+        static inline void store(void* mem, std::basic_string_view<Char> value) { owned_string_traits<Char>::store(mem, value.data(), value.size()); }
+    };
+#endif
+
+    // other arrays are copied into a std::array, which is formatted the same way
+    template<typename Char, typename T, std::size_t N>
+    struct owned_traits<Char, T[N], typename std::enable_if<!std::is_same<typename std::remove_const<T>::type, Char>::value>::type> {
+        typedef std::array<typename std::remove_const<T>::type, N> stored_type;
+
+        static const std::size_t alignment = alignof(stored_type);
+
+        static inline std::size_t size(const T (&)[N]) { return sizeof(stored_type); }
+
+        static inline void store(void* mem, const T (&value)[N]) {
+            stored_type* array = new (mem) stored_type();
+            for (std::size_t i = 0; i < N; ++ i) {
+                (*array)[i] = value[i];
+            }
+        }
+
+        static inline BasicFormatter<Char> make_formatter(const void* mem) {
+            return format_traits<Char,stored_type>::make_formatter(*static_cast<const stored_type*>(mem));
+        }
+    };
+
+    // A format together with copies of its arguments, so that it can be
+    // queued and written later, possibly on another thread. The arguments
+    // are stored in one contiguous record: a table with one entry per
+    // argument followed by the argument values.
+    //
+    // BasicFormat::bind_owned() copies (and thereby keeps alive) the format,
+    // BasicFormatRef::bind_owned() only refers to it.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicOwnedFormat {
+    public:
+        typedef Char char_type;
+
+        struct Arg {
+            BasicFormatter<Char> (*make_formatter)(const void* value);
+            void                 (*destroy)(void* value);
+            std::size_t          offset;
+        };
+
+        // empty, writes nothing
+        BasicOwnedFormat() noexcept :
+                m_format(BasicFormatItems<Char>()), m_record(nullptr), m_size(0), m_argc(0) {}
+
+        template<typename... Args>
+        BasicOwnedFormat(BasicFormat<Char> format, const Args&... args) :
+                m_format(std::move(format)), m_record(nullptr), m_size(0), m_argc(0) {
+            std::size_t offsets[sizeof...(Args) + 1];
+            std::size_t size = sizeof(Arg) * sizeof...(Args);
+            std::size_t index = 0;
+            int reserve[] = {0, (offsets[index ++] = reserve_arg<Args>(size, args), 0)...};
+            (void)reserve;
+            (void)offsets;
+
+            m_record = static_cast<char*>(::operator new(size));
+            m_size = size;
+
+            FORMATSTRING_TRY {
+                index = 0;
+                int store[] = {0, (store_arg<Args>(offsets[index ++], args), 0)...};
+                (void)store;
+            }
+            FORMATSTRING_CATCH_ALL {
+                clear();
+                FORMATSTRING_RETHROW;
+            }
+        }
+
+        BasicOwnedFormat(BasicOwnedFormat<Char>&& other) noexcept :
+                m_format(std::move(other.m_format)), m_record(other.m_record), m_size(other.m_size), m_argc(other.m_argc) {
+            other.m_record = nullptr;
+            other.m_size = 0;
+            other.m_argc = 0;
+        }
+
+        BasicOwnedFormat(const BasicOwnedFormat<Char>& other) = delete;
+
+        ~BasicOwnedFormat() {
+            clear();
+        }
+
+        BasicOwnedFormat<Char>& operator= (BasicOwnedFormat<Char>&& other) noexcept {
+            if (this != &other) {
+                clear();
+                m_format = std::move(other.m_format);
+                m_record = other.m_record;
+                m_size   = other.m_size;
+                m_argc   = other.m_argc;
+                other.m_record = nullptr;
+                other.m_size = 0;
+                other.m_argc = 0;
+            }
+            return *this;
+        }
+
+        BasicOwnedFormat<Char>& operator= (const BasicOwnedFormat<Char>& other) = delete;
+
+        void write_into(std::basic_ostream<Char>& out) const;
+
+        inline operator std::basic_string<Char> () const {
+            return str();
+        }
+
+        std::basic_string<Char> str() const;
+
+        inline const BasicFormat<Char>& format() const noexcept { return m_format; }
+
+        // number of arguments and size of the argument record in bytes
+        inline std::size_t argc() const noexcept { return m_argc; }
+        inline std::size_t size() const noexcept { return m_size; }
+
+    private:
+        static inline std::size_t align(std::size_t offset, std::size_t alignment) noexcept {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+
+        template<typename T>
+        static std::size_t reserve_arg(std::size_t& size, const T& value) {
+            static_assert(owned_traits<Char,T>::alignment <= alignof(std::max_align_t), "over-aligned argument type");
+            std::size_t offset = align(size, owned_traits<Char,T>::alignment);
+            size = offset + owned_traits<Char,T>::size(value);
+            return offset;
+        }
+
+        template<typename T>
+        static void destroy_arg(void* value) {
+            typedef typename owned_traits<Char,T>::stored_type Stored;
+            static_cast<Stored*>(value)->~Stored();
+        }
+
+        template<typename T>
+        void store_arg(std::size_t offset, const T& value) {
+            typedef typename owned_traits<Char,T>::stored_type Stored;
+            owned_traits<Char,T>::store(m_record + offset, value);
+
+            Arg& arg = reinterpret_cast<Arg*>(m_record)[m_argc];
+            arg.make_formatter = &owned_traits<Char,T>::make_formatter;
+            arg.destroy        = std::is_trivially_destructible<Stored>::value ? nullptr : &destroy_arg<T>;
+            arg.offset         = offset;
+            ++ m_argc;
+        }
+
+        void clear() noexcept;
+
+        BasicFormat<Char> m_format;
+        char*             m_record;
+        std::size_t       m_size;
+        std::size_t       m_argc;
+    };
+
+    template<typename Char>
+    template<typename... Args>
+    inline BasicOwnedFormat<Char> BasicFormat<Char>::bind_owned(const Args&... args) const {
+        return BasicOwnedFormat<Char>(*this, args...);
+    }
+
+    template<typename Char>
+    template<typename... Args>
+    inline BasicOwnedFormat<Char> BasicFormatRef<Char>::bind_owned(const Args&... args) const {
+        return BasicOwnedFormat<Char>(BasicFormat<Char>(m_items), args...);
+    }
+
+    template<typename Char, typename OStream>
+    inline OStream& operator << (OStream& out, const BasicOwnedFormat<Char>& fmt) {
+        fmt.write_into(out);
+        return out;
+    }
+
+    typedef BasicOwnedFormat<char> OwnedFormat;
+    typedef BasicOwnedFormat<wchar_t> WOwnedFormat;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicOwnedFormat<char16_t> U16OwnedFormat;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicOwnedFormat<char32_t> U32OwnedFormat;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicOwnedFormat<char>;
+    extern template class FORMATSTRING_EXPORT BasicOwnedFormat<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicOwnedFormat<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicOwnedFormat<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_OWNEDFORMAT_H
@@ -0,0 +1,98 @@
+#ifndef FORMATSTRING_PRINT_H
+#define FORMATSTRING_PRINT_H
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/formatitem.h"
+#include "formatstring/formatter.h"
+#include "formatstring/format_traits.h"
+
+namespace formatstring {
+
+    // Where print() and println() go: a file descriptor, which gets one
+    // write(2) per call, or a FILE*, which gets one fwrite() per call.
+    // Neither touches std::cout or depends on sync_with_stdio.
+    class FORMATSTRING_EXPORT PrintTarget {
+    public:
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+        PrintTarget(int fd) noexcept : m_fd(fd), m_file(nullptr) {}
+#endif
+        PrintTarget(std::FILE* file) noexcept : m_fd(-1), m_file(file) {}
+
+        // writes all of data, throws std::system_error on failure
+        void write(const void* data, std::size_t size) const;
+
+    private:
+        int        m_fd;
+        std::FILE* m_file;
+    };
+
+    // Formats the whole output into a scratch buffer of the calling thread
+    // (see scratch.h) and hands it to target at once, so lines printed by
+    // different threads don't interleave. Characters are written as they
+    // are, wide characters are not converted.
+    template<typename Char>
+    FORMATSTRING_EXPORT void print_items(PrintTarget target, const BasicFormatItems<Char>& items,
+                                         const BasicFormatters<Char>& formatters, bool newline);
+
+    template<typename Char, typename... Args>
+    inline void print(PrintTarget target, const BasicFormatRef<Char>& fmt, const Args&... args) {
+        print_items(target, fmt.items(), {format_traits<Char,Args>::make_formatter(args)...}, false);
+    }
+
+    template<typename Char, typename... Args>
+    inline void print(PrintTarget target, const BasicFormat<Char>& fmt, const Args&... args) {
+        print_items(target, fmt.items(), {format_traits<Char,Args>::make_formatter(args)...}, false);
+    }
+
+    template<typename Char, typename... Args>
+    inline void print(PrintTarget target, const Char* fmt, const Args&... args) {
+        print_items(target, parse_format(fmt), {format_traits<Char,Args>::make_formatter(args)...}, false);
+    }
+
+    template<typename Char, typename... Args>
+    inline void print(PrintTarget target, const std::basic_string<Char>& fmt, const Args&... args) {
+        print_items(target, parse_format(fmt.c_str(), fmt.size()), {format_traits<Char,Args>::make_formatter(args)...}, false);
+    }
+
+    // like print(), with a newline appended to the same write
+    template<typename Char, typename... Args>
+    inline void println(PrintTarget target, const BasicFormatRef<Char>& fmt, const Args&... args) {
+        print_items(target, fmt.items(), {format_traits<Char,Args>::make_formatter(args)...}, true);
+    }
+
+    template<typename Char, typename... Args>
+    inline void println(PrintTarget target, const BasicFormat<Char>& fmt, const Args&... args) {
+        print_items(target, fmt.items(), {format_traits<Char,Args>::make_formatter(args)...}, true);
+    }
+
+    template<typename Char, typename... Args>
+    inline void println(PrintTarget target, const Char* fmt, const Args&... args) {
+        print_items(target, parse_format(fmt), {format_traits<Char,Args>::make_formatter(args)...}, true);
+    }
+
+    template<typename Char, typename... Args>
+    inline void println(PrintTarget target, const std::basic_string<Char>& fmt, const Args&... args) {
+        print_items(target, parse_format(fmt.c_str(), fmt.size()), {format_traits<Char,Args>::make_formatter(args)...}, true);
+    }
+
+    // ---- extern template instantiations ----
+    extern template FORMATSTRING_EXPORT void print_items<char>(PrintTarget target, const FormatItems& items, const Formatters& formatters, bool newline);
+    extern template FORMATSTRING_EXPORT void print_items<wchar_t>(PrintTarget target, const WFormatItems& items, const WFormatters& formatters, bool newline);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template FORMATSTRING_EXPORT void print_items<char16_t>(PrintTarget target, const U16FormatItems& items, const U16Formatters& formatters, bool newline);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template FORMATSTRING_EXPORT void print_items<char32_t>(PrintTarget target, const U32FormatItems& items, const U32Formatters& formatters, bool newline);
+#endif
+}
+
+#endif // FORMATSTRING_PRINT_H
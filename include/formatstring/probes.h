@@ -0,0 +1,95 @@
+#ifndef FORMATSTRING_PROBES_H
+#define FORMATSTRING_PROBES_H
+#pragma once
+
+#include "formatstring/config.h"
+
+// Static tracepoints (USDT probes of provider "formatstring") compiled in
+// with WITH_USDT=ON. They live in the library and are no-ops until a
+// tracer attaches, the elapsed times are only measured then:
+//
+//   parse__start (const void* fmt, size_t size)
+//   parse__done  (const void* fmt, const void* items, uint64_t nanos)
+//                items is null if the format string was invalid
+//   bind         (const void* items, size_t args)
+//   apply__start (const void* items)
+//   apply__done  (const void* items, int64_t length, uint64_t nanos)
+//                length is -1 unless the output goes to memory (a string
+//                stream or scratch buffer), other streams aren't asked for
+//                their position because that may flush or seek them
+//
+// items identifies a compiled format, it is the address of its first item.
+// For example:
+//
+//   bpftrace -e 'usdt:/usr/lib/libformatstring09.so:formatstring:apply__done
+//                { @ns[arg0] = hist(arg2); }'
+
+#ifdef FORMATSTRING_USDT
+
+#include <iosfwd>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "formatstring/export.h"
+
+#define FORMATSTRING_PROBE_BIND(items, args) ::formatstring::probe_bind((items), (args))
+
+namespace formatstring {
+
+    FORMATSTRING_EXPORT void probe_bind(const void* items, std::size_t args) noexcept;
+
+    // Fires parse__start on construction and parse__done on destruction.
+    class FORMATSTRING_EXPORT ParseProbe {
+    public:
+        ParseProbe(const void* fmt, std::size_t size) noexcept;
+        ~ParseProbe();
+
+        ParseProbe(const ParseProbe& other) = delete;
+        ParseProbe& operator= (const ParseProbe& other) = delete;
+
+        inline void set_items(const void* items) noexcept { m_items = items; }
+
+    private:
+        const void*                           m_fmt;
+        const void*                           m_items;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Fires apply__start on construction and apply__done on destruction.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicApplyProbe {
+    public:
+        BasicApplyProbe(const void* items, std::basic_ostream<Char>& out);
+        ~BasicApplyProbe();
+
+        BasicApplyProbe(const BasicApplyProbe<Char>& other) = delete;
+        BasicApplyProbe<Char>& operator= (const BasicApplyProbe<Char>& other) = delete;
+
+    private:
+        const void*                           m_items;
+        std::basic_ostream<Char>*             m_out;
+        std::int64_t                          m_pos;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicApplyProbe<char>;
+    extern template class FORMATSTRING_EXPORT BasicApplyProbe<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicApplyProbe<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicApplyProbe<char32_t>;
+#endif
+}
+
+#else
+
+#define FORMATSTRING_PROBE_BIND(items, args) ((void)0)
+
+#endif // FORMATSTRING_USDT
+
+#endif // FORMATSTRING_PROBES_H
@@ -0,0 +1,112 @@
+#ifndef FORMATSTRING_SAFEFORMAT_H
+#define FORMATSTRING_SAFEFORMAT_H
+#pragma once
+
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/formatitem.h"
+
+namespace formatstring {
+
+    // An argument of safe_format(). Constructing one only stores the value.
+    class SafeArg {
+    public:
+        enum Kind {
+            None,
+            Bool,
+            Char,
+            Int,
+            UInt,
+            Pointer,
+            String
+        };
+
+        inline SafeArg() noexcept : kind(None) { value.u = 0; }
+
+        inline SafeArg(bool v) noexcept               : kind(Bool)  { value.b = v; }
+        inline SafeArg(char v) noexcept               : kind(Char)  { value.c = v; }
+        inline SafeArg(signed char v) noexcept        : kind(Int)   { value.i = v; }
+        inline SafeArg(short v) noexcept              : kind(Int)   { value.i = v; }
+        inline SafeArg(int v) noexcept                : kind(Int)   { value.i = v; }
+        inline SafeArg(long v) noexcept               : kind(Int)   { value.i = v; }
+        inline SafeArg(long long v) noexcept          : kind(Int)   { value.i = v; }
+        inline SafeArg(unsigned char v) noexcept      : kind(UInt)  { value.u = v; }
+        inline SafeArg(unsigned short v) noexcept     : kind(UInt)  { value.u = v; }
+        inline SafeArg(unsigned int v) noexcept       : kind(UInt)  { value.u = v; }
+        inline SafeArg(unsigned long v) noexcept      : kind(UInt)  { value.u = v; }
+        inline SafeArg(unsigned long long v) noexcept : kind(UInt)  { value.u = v; }
+        inline SafeArg(const char* v) noexcept        : kind(String) { value.s = v; }
+        inline SafeArg(std::nullptr_t) noexcept       : kind(Pointer) { value.p = nullptr; }
+
+        template<typename T>
+        inline SafeArg(const T* v) noexcept           : kind(Pointer) { value.p = v; }
+
+        Kind kind;
+        union {
+            bool               b;
+            char               c;
+            long long          i;
+            unsigned long long u;
+            const void*        p;
+            const char*        s;
+        } value;
+    };
+
+    // Formatting that is async-signal-safe, for crash handlers and the
+    // like. It doesn't allocate, lock or throw and doesn't use iostreams.
+    // The format string grammar and the spec grammar are the same as for
+    // format(), but only integers, characters, booleans, pointers and
+    // strings can be formatted, and ',' is ignored when padding with '0'.
+    // A replacement field that can't be formatted, because it is malformed,
+    // refers to a missing argument or asks for an unsupported type, is
+    // copied to the output as it is.
+    //
+    // Writes at most size - 1 characters and a terminating NUL to buffer
+    // and returns the number of characters written without the NUL.
+    FORMATSTRING_EXPORT std::size_t safe_vformat(char* buffer, std::size_t size, const char* fmt,
+                                                 const SafeArg* args, std::size_t count) noexcept;
+
+    // Formats already compiled items, e.g. from BasicFixedFormatItems (see
+    // fixedformat.h). A field that can't be formatted is written as its
+    // argument index in braces.
+    FORMATSTRING_EXPORT std::size_t safe_vformat(char* buffer, std::size_t size, const FormatItems& items,
+                                                 const SafeArg* args, std::size_t count) noexcept;
+
+    template<typename... Args>
+    inline std::size_t safe_format(char* buffer, std::size_t size, const char* fmt, const Args&... args) noexcept {
+        const SafeArg list[] = {SafeArg(args)..., SafeArg()};
+        return safe_vformat(buffer, size, fmt, list, sizeof...(Args));
+    }
+
+    template<typename... Args>
+    inline std::size_t safe_format(char* buffer, std::size_t size, const FormatItems& items, const Args&... args) noexcept {
+        const SafeArg list[] = {SafeArg(args)..., SafeArg()};
+        return safe_vformat(buffer, size, items, list, sizeof...(Args));
+    }
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    // output of safe_print() longer than this is truncated
+    static const std::size_t SAFE_PRINT_BUFFER_SIZE = 1024;
+
+    // Formats into a buffer on the stack and writes it to fd with write(2).
+    // Keeps errno unchanged.
+    FORMATSTRING_EXPORT void safe_vprint(int fd, const char* fmt, const SafeArg* args, std::size_t count) noexcept;
+    FORMATSTRING_EXPORT void safe_vprint(int fd, const FormatItems& items, const SafeArg* args, std::size_t count) noexcept;
+
+    template<typename... Args>
+    inline void safe_print(int fd, const char* fmt, const Args&... args) noexcept {
+        const SafeArg list[] = {SafeArg(args)..., SafeArg()};
+        safe_vprint(fd, fmt, list, sizeof...(Args));
+    }
+
+    template<typename... Args>
+    inline void safe_print(int fd, const FormatItems& items, const Args&... args) noexcept {
+        const SafeArg list[] = {SafeArg(args)..., SafeArg()};
+        safe_vprint(fd, items, list, sizeof...(Args));
+    }
+#endif
+}
+
+#endif // FORMATSTRING_SAFEFORMAT_H
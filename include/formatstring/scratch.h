@@ -0,0 +1,76 @@
+#ifndef FORMATSTRING_SCRATCH_H
+#define FORMATSTRING_SCRATCH_H
+#pragma once
+
+#include <iosfwd>
+#include <locale>
+#include <string>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+
+namespace formatstring {
+
+    // A growable character buffer with an ostream writing into it, used for
+    // temporaries while formatting a value. Buffers come from a small pool
+    // of the calling thread and go back to it on destruction, so once a
+    // thread is warmed up they don't allocate and no allocator lock is
+    // shared between threads. Nested buffers are fine, each gets its own.
+    //
+    // The stream is handed out with default flags, precision, width and
+    // fill, and with the global or the given locale. Pooled streams keep
+    // their locale, so it is only imbued again when it changes.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicScratchBuffer {
+    public:
+        typedef Char char_type;
+
+        BasicScratchBuffer();
+        explicit BasicScratchBuffer(const std::locale& locale);
+        ~BasicScratchBuffer();
+
+        BasicScratchBuffer(const BasicScratchBuffer<Char>& other) = delete;
+        BasicScratchBuffer<Char>& operator= (const BasicScratchBuffer<Char>& other) = delete;
+
+        std::basic_ostream<Char>& stream() noexcept;
+
+        // not NUL terminated
+        const Char* data() const noexcept;
+        std::size_t size() const noexcept;
+
+        inline std::basic_string<Char> str() const {
+            return std::basic_string<Char>(data(), size());
+        }
+
+    private:
+        void acquire(const std::locale& locale);
+
+        void* m_impl;
+    };
+
+    typedef BasicScratchBuffer<char>    ScratchBuffer;
+    typedef BasicScratchBuffer<wchar_t> WScratchBuffer;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicScratchBuffer<char16_t> U16ScratchBuffer;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicScratchBuffer<char32_t> U32ScratchBuffer;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicScratchBuffer<char>;
+    extern template class FORMATSTRING_EXPORT BasicScratchBuffer<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicScratchBuffer<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicScratchBuffer<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_SCRATCH_H
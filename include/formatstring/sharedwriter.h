@@ -0,0 +1,92 @@
+#ifndef FORMATSTRING_SHAREDWRITER_H
+#define FORMATSTRING_SHAREDWRITER_H
+#pragma once
+
+#include <iosfwd>
+#include <mutex>
+#include <cstddef>
+
+#include "formatstring/config.h"
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/ownedformat.h"
+#include "formatstring/scratch.h"
+
+namespace formatstring {
+
+    // Lets many threads write whole records to one stream or file
+    // descriptor. Every thread formats into its own scratch buffer (see
+    // scratch.h) without holding any lock, and the finished record is then
+    // committed under a mutex: with one out.write() for streams, and with
+    // write(2) for file descriptors, retrying short writes before the lock
+    // is released. Records written through the same writer never
+    // interleave. Other writers of the same file descriptor only don't
+    // split them if each record is written at once, e.g. to a file opened
+    // with O_APPEND or to a pipe for records up to PIPE_BUF bytes.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicSharedWriter {
+    public:
+        typedef Char char_type;
+
+        explicit BasicSharedWriter(std::basic_ostream<Char>& out);
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+        // writes the raw characters to fd, which isn't closed by the writer
+        explicit BasicSharedWriter(int fd);
+#endif
+
+        BasicSharedWriter(const BasicSharedWriter<Char>& other) = delete;
+        BasicSharedWriter<Char>& operator= (const BasicSharedWriter<Char>& other) = delete;
+
+        template<typename... Args>
+        inline void write(const BasicFormatRef<Char>& format, const Args&... args) {
+            BasicScratchBuffer<Char> buffer;
+            format.format(buffer.stream(), args...);
+            commit(buffer.data(), buffer.size());
+        }
+
+        template<typename... Args>
+        inline void write(const BasicFormat<Char>& format, const Args&... args) {
+            write(format.ref(), args...);
+        }
+
+        inline void write(const BasicOwnedFormat<Char>& format) {
+            BasicScratchBuffer<Char> buffer;
+            format.write_into(buffer.stream());
+            commit(buffer.data(), buffer.size());
+        }
+
+        // appends size characters as one record
+        void commit(const Char* data, std::size_t size);
+
+    private:
+        std::basic_ostream<Char>* m_out;
+        int                       m_fd;
+        std::mutex                m_mutex;
+    };
+
+    typedef BasicSharedWriter<char>    SharedWriter;
+    typedef BasicSharedWriter<wchar_t> WSharedWriter;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicSharedWriter<char16_t> U16SharedWriter;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicSharedWriter<char32_t> U32SharedWriter;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicSharedWriter<char>;
+    extern template class FORMATSTRING_EXPORT BasicSharedWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicSharedWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicSharedWriter<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_SHAREDWRITER_H
@@ -0,0 +1,112 @@
+#ifndef FORMATSTRING_VECTOREDWRITER_H
+#define FORMATSTRING_VECTOREDWRITER_H
+#pragma once
+
+#include "formatstring/config.h"
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+
+#include <vector>
+#include <cstddef>
+
+#include <sys/uio.h>
+
+#include "formatstring/export.h"
+#include "formatstring/format.h"
+#include "formatstring/formatitem.h"
+#include "formatstring/formatter.h"
+#include "formatstring/format_traits.h"
+
+namespace formatstring {
+
+    // Collects formatted records as a list of segments and writes them to a
+    // file descriptor with writev(2). Long literal text is not copied, its
+    // segments point straight into the literal pool of the compiled format.
+    // Only formatted values and short literals, for which another iovec
+    // would cost more than the copy, go into the writer's own buffer.
+    //
+    // Because of that every format written has to stay alive until the next
+    // flush(). The writer flushes by itself when its buffer or the number of
+    // segments gets too large, and when it is destroyed. It must not be used
+    // by several threads at once.
+    template<typename Char>
+    class FORMATSTRING_EXPORT BasicVectoredWriter {
+    public:
+        typedef Char char_type;
+
+        // literals shorter than this many characters are copied
+        static const std::size_t MIN_REFERENCED_LITERAL = 32;
+
+        // fd isn't closed by the writer
+        explicit BasicVectoredWriter(int fd, std::size_t buffer_size = 64 * 1024);
+
+        BasicVectoredWriter(const BasicVectoredWriter<Char>& other) = delete;
+        BasicVectoredWriter<Char>& operator= (const BasicVectoredWriter<Char>& other) = delete;
+
+        // flushes, errors are ignored
+        ~BasicVectoredWriter();
+
+        template<typename... Args>
+        inline void write(const BasicFormatRef<Char>& format, const Args&... args) {
+            append(format.items(), {format_traits<Char,Args>::make_formatter(args)...});
+        }
+
+        template<typename... Args>
+        inline void write(const BasicFormat<Char>& format, const Args&... args) {
+            append(format.items(), {format_traits<Char,Args>::make_formatter(args)...});
+        }
+
+        // Adds one record. If a formatter throws nothing of the record is
+        // kept.
+        void append(const BasicFormatItems<Char>& items, const BasicFormatters<Char>& formatters);
+
+        // Writes all pending segments. Throws std::system_error on failure,
+        // the pending records are discarded then.
+        void flush();
+
+        // number of pending segments and characters
+        inline std::size_t segments() const noexcept { return m_segments.size(); }
+        std::size_t size() const noexcept;
+
+    private:
+        struct Segment {
+            const Char* literal; // nullptr: offset into m_values
+            std::size_t offset;
+            std::size_t length;
+        };
+
+        int                  m_fd;
+        std::size_t          m_buffer_size;
+        std::size_t          m_max_segments;
+        std::vector<Segment> m_segments;
+        std::vector<Char>    m_values;
+        std::vector<iovec>   m_iov;
+    };
+
+    typedef BasicVectoredWriter<char>    VectoredWriter;
+    typedef BasicVectoredWriter<wchar_t> WVectoredWriter;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    typedef BasicVectoredWriter<char16_t> U16VectoredWriter;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    typedef BasicVectoredWriter<char32_t> U32VectoredWriter;
+#endif
+
+    // ---- extern template instantiations ----
+    extern template class FORMATSTRING_EXPORT BasicVectoredWriter<char>;
+    extern template class FORMATSTRING_EXPORT BasicVectoredWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicVectoredWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+    extern template class FORMATSTRING_EXPORT BasicVectoredWriter<char32_t>;
+#endif
+}
+
+#endif // FORMATSTRING_POSIX_IO_SUPPORT
+
+#endif // FORMATSTRING_VECTOREDWRITER_H
@@ -0,0 +1,69 @@
+#include "formatstring/allocstats.h"
+
+#ifdef FORMATSTRING_ALLOC_STATS
+
+#include "formatstring/exceptions.h"
+#include "allocnew.h"
+
+#include <new>
+#include <cstdlib>
+
+// The replaced operators are in a translation unit of their own, so
+// callers in the library can't inline free() and GCC doesn't warn about
+// mismatched new and delete.
+
+using formatstring::impl::count_alloc;
+
+void* operator new(std::size_t size) {
+    count_alloc(size);
+    for (;;) {
+        void* ptr = std::malloc(size ? size : 1);
+        if (ptr) {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            FORMATSTRING_THROW(std::bad_alloc());
+        }
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    count_alloc(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+#endif // FORMATSTRING_ALLOC_STATS
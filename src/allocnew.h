@@ -0,0 +1,16 @@
+#ifndef FORMATSTRING_ALLOCNEW_H
+#define FORMATSTRING_ALLOCNEW_H
+#pragma once
+
+#include <cstddef>
+
+namespace formatstring {
+    namespace impl {
+
+        // Counts an allocation of the calling thread (see allocstats.cpp).
+        void count_alloc(std::size_t size) noexcept;
+
+    }
+}
+
+#endif // FORMATSTRING_ALLOCNEW_H
@@ -0,0 +1,181 @@
+#include "formatstring/allocstats.h"
+
+#ifdef FORMATSTRING_ALLOC_STATS
+
+#include "formatstring/format.h"
+#include "formatstring/format_traits.h"
+#include "allocnew.h"
+
+#include <mutex>
+#include <ostream>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace formatstring;
+
+namespace {
+    struct ThreadCounter {
+        std::size_t allocations;
+        std::size_t bytes;
+        bool        suspended; // the accounting's own allocations aren't counted
+    };
+
+    thread_local ThreadCounter thread_counter = {0, 0, false};
+
+    class Suspend {
+    public:
+        Suspend() noexcept : m_suspended(thread_counter.suspended) {
+            thread_counter.suspended = true;
+        }
+
+        ~Suspend() {
+            thread_counter.suspended = m_suspended;
+        }
+
+    private:
+        bool m_suspended;
+    };
+
+    struct Table {
+        std::mutex mutex;
+        std::unordered_map<const void*, FormatAllocStats> formats;
+    };
+
+    // never destroyed, scopes may still end during static destruction
+    Table& table() {
+        static Table* instance = new Table();
+        return *instance;
+    }
+
+    template<typename Char>
+    std::string ascii_label(const Char* str, std::size_t size) {
+        std::string label;
+        label.reserve(size);
+        for (const Char* end = str + size; str < end; ++ str) {
+            unsigned long ch = (unsigned long)*str;
+            label += ch < 0x80 ? (char)ch : '?';
+        }
+        return label;
+    }
+
+    inline void add(AllocCounter& counter, std::size_t allocations, std::size_t bytes) noexcept {
+        ++ counter.calls;
+        counter.allocations += allocations;
+        counter.bytes += bytes;
+    }
+}
+
+void formatstring::impl::count_alloc(std::size_t size) noexcept {
+    ThreadCounter& counter = thread_counter;
+    if (!counter.suspended) {
+        ++ counter.allocations;
+        counter.bytes += size;
+    }
+}
+
+AllocScope::AllocScope(const void* key, AllocPhase phase) noexcept :
+    m_key(key),
+    m_phase(phase),
+    m_allocations(thread_counter.allocations),
+    m_bytes(thread_counter.bytes),
+    m_label(nullptr),
+    m_label_size(0),
+    m_char_size(0) {}
+
+AllocScope::~AllocScope() {
+    std::size_t allocations = thread_counter.allocations - m_allocations;
+    std::size_t bytes = thread_counter.bytes - m_bytes;
+
+    // formats used by the accounting itself aren't recorded
+    if (!m_key || thread_counter.suspended) {
+        return;
+    }
+
+    Suspend suspend;
+    Table& stats = table();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+
+    FormatAllocStats& entry = stats.formats[m_key];
+    entry.key = m_key;
+
+    if (m_label) {
+        switch (m_char_size) {
+            case sizeof(char):
+                entry.label = ascii_label((const char*)m_label, m_label_size);
+                break;
+
+            case sizeof(char16_t):
+                entry.label = ascii_label((const char16_t*)m_label, m_label_size);
+                break;
+
+            default:
+                entry.label = ascii_label((const char32_t*)m_label, m_label_size);
+                break;
+        }
+    }
+
+    switch (m_phase) {
+        case ParsePhase:
+            add(entry.parse, allocations, bytes);
+            break;
+
+        case BindPhase:
+            add(entry.bind, allocations, bytes);
+            break;
+
+        case ApplyPhase:
+            add(entry.apply, allocations, bytes);
+            break;
+    }
+}
+
+AllocCounter formatstring::thread_alloc_counter() noexcept {
+    AllocCounter counter = {0, thread_counter.allocations, thread_counter.bytes};
+    return counter;
+}
+
+std::vector<FormatAllocStats> formatstring::alloc_stats() {
+    Table& stats = table();
+    std::vector<FormatAllocStats> formats;
+    {
+        Suspend suspend;
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        formats.reserve(stats.formats.size());
+        for (const auto& entry : stats.formats) {
+            formats.push_back(entry.second);
+        }
+    }
+
+    std::sort(formats.begin(), formats.end(), [](const FormatAllocStats& lhs, const FormatAllocStats& rhs) {
+        return lhs.parse.bytes + lhs.bind.bytes + lhs.apply.bytes >
+               rhs.parse.bytes + rhs.bind.bytes + rhs.apply.bytes;
+    });
+
+    return formats;
+}
+
+void formatstring::reset_alloc_stats() {
+    Suspend suspend;
+    Table& stats = table();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    stats.formats.clear();
+}
+
+void formatstring::dump_alloc_stats(std::ostream& out) {
+    Suspend suspend;
+    const Format columns = compile(" {: >8} {: >8} {: >10}");
+
+    for (const char* phase : {"parses", "binds", "applies"}) {
+        columns.format(out, phase, "allocs", "bytes");
+    }
+    out << "  format\n";
+
+    for (const FormatAllocStats& stats : alloc_stats()) {
+        for (const AllocCounter* phase : {&stats.parse, &stats.bind, &stats.apply}) {
+            columns.format(out, phase->calls, phase->allocations, phase->bytes);
+        }
+        out << format("  {!r}\n", stats.label);
+    }
+}
+
+#endif // FORMATSTRING_ALLOC_STATS
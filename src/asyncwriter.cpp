@@ -0,0 +1,232 @@
+#include "formatstring/asyncwriter.h"
+
+#include <ostream>
+#include <chrono>
+
+using namespace formatstring;
+
+template<typename Char>
+BasicAsyncWriter<Char>::BasicAsyncWriter(std::basic_ostream<Char>& out, std::size_t capacity, OverflowPolicy policy, std::size_t batch) :
+        m_out(out), m_policy(policy), m_batch(batch > 0 ? batch : 1), m_mask(0), m_slots(nullptr),
+        m_tail(0), m_head(0), m_completed(0), m_written(0), m_dropped(0), m_errors(0), m_max_depth(0),
+        m_sleeping(false), m_stopping(false) {
+    std::size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    m_mask  = size - 1;
+    m_slots = new Slot[size];
+    for (std::size_t i = 0; i < size; ++ i) {
+        m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    m_thread = std::thread(&BasicAsyncWriter<Char>::run, this);
+}
+
+template<typename Char>
+BasicAsyncWriter<Char>::~BasicAsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping.store(true);
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+    delete [] m_slots;
+}
+
+template<typename Char>
+bool BasicAsyncWriter<Char>::try_push(record_type& record) {
+    std::size_t pos = m_tail.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+        slot = &m_slots[pos & m_mask];
+        std::size_t seq = slot->seq.load(std::memory_order_acquire);
+        std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)pos;
+
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    new (&slot->storage) record_type(std::move(record));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename Char>
+bool BasicAsyncWriter<Char>::try_pop(record_type* record) {
+    std::size_t pos = m_head.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+        slot = &m_slots[pos & m_mask];
+        std::size_t seq = slot->seq.load(std::memory_order_acquire);
+        std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    record_type* queued = reinterpret_cast<record_type*>(&slot->storage);
+    *record = std::move(*queued);
+    queued->~record_type();
+    slot->seq.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename Char>
+void BasicAsyncWriter<Char>::wake() noexcept {
+    // pairs with the fence in run(), so either the writer sees the new
+    // record or we see that it went to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeup.notify_one();
+    }
+}
+
+template<typename Char>
+bool BasicAsyncWriter<Char>::push(record_type&& record) {
+    if (try_push(record)) {
+        wake();
+        return true;
+    }
+
+    switch (m_policy) {
+    case DropOnOverflow:
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+
+    case DropOldestOnOverflow:
+        for (;;) {
+            record_type oldest;
+            if (try_pop(&oldest)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_completed.fetch_add(1, std::memory_order_release);
+            }
+            if (try_push(record)) {
+                break;
+            }
+        }
+        wake();
+        return true;
+
+    default:
+        for (unsigned int spins = 0; !try_push(record); ++ spins) {
+            wake();
+            if (spins < 64) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        wake();
+        return true;
+    }
+}
+
+template<typename Char>
+void BasicAsyncWriter<Char>::run() {
+    record_type record;
+
+    for (;;) {
+        std::size_t depth = m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed);
+        if (depth > m_max_depth.load(std::memory_order_relaxed)) {
+            m_max_depth.store(depth, std::memory_order_relaxed);
+        }
+
+        std::size_t count = 0;
+        while (count < m_batch && try_pop(&record)) {
+            FORMATSTRING_TRY {
+                record.write_into(m_out);
+                m_written.fetch_add(1, std::memory_order_relaxed);
+            }
+            FORMATSTRING_CATCH_ALL {
+                m_errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_completed.fetch_add(1, std::memory_order_release);
+            ++ count;
+        }
+
+        if (count > 0) {
+            m_out.flush();
+            m_progress.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping.load()) {
+            // the queue was drained above
+            break;
+        }
+
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_relaxed)) {
+            // the timeout only guards against missed wakeups
+            m_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        m_sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    m_progress.notify_all();
+}
+
+template<typename Char>
+void BasicAsyncWriter<Char>::flush() {
+    std::uint64_t target = m_tail.load(std::memory_order_acquire);
+    wake();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_completed.load(std::memory_order_acquire) < target) {
+        m_progress.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+template<typename Char>
+AsyncWriterStats BasicAsyncWriter<Char>::stats() const noexcept {
+    AsyncWriterStats stats;
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+
+    stats.capacity  = m_mask + 1;
+    stats.depth     = tail > head ? tail - head : 0;
+    stats.max_depth = m_max_depth.load(std::memory_order_relaxed);
+    stats.enqueued  = tail;
+    stats.written   = m_written.load(std::memory_order_relaxed);
+    stats.dropped   = m_dropped.load(std::memory_order_relaxed);
+    stats.errors    = m_errors.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+template class BasicAsyncWriter<char>;
+template class BasicAsyncWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicAsyncWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicAsyncWriter<char32_t>;
+#endif
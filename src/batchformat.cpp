@@ -0,0 +1,189 @@
+#include "formatstring/batchformat.h"
+#include "formatstring/scratch.h"
+
+#include <ostream>
+#include <string>
+#include <locale>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+using namespace formatstring;
+
+namespace {
+    const std::size_t MIN_CHUNK_ROWS = 64;
+    const std::size_t MAX_CHUNK_ROWS = 16384;
+
+    template<typename Char>
+    struct Chunk {
+        std::basic_string<Char> text;
+        std::exception_ptr      error;
+        bool                    ready;
+    };
+
+    // Chunk n is rendered into slot n % slots.size(). Workers claim chunks
+    // in order and don't start one before its slot was written out.
+    template<typename Char>
+    struct Batch {
+        BasicBatchRenderer<Char>   render;
+        const void*                context;
+        std::locale                locale;
+        std::size_t                count;
+        std::size_t                rows;
+        std::size_t                chunks;
+
+        std::mutex                 mutex;
+        std::condition_variable    rendered;
+        std::condition_variable    written;
+        std::vector< Chunk<Char> > slots;
+        std::size_t                next;
+        std::size_t                done;
+        bool                       stopping;
+
+        void work() {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            for (;;) {
+                if (stopping || next >= chunks) {
+                    break;
+                }
+
+                std::size_t chunk = next ++;
+                while (!stopping && chunk >= done + slots.size()) {
+                    written.wait(lock);
+                }
+                if (stopping) {
+                    break;
+                }
+
+                lock.unlock();
+                std::size_t begin = chunk * rows;
+                std::size_t end   = std::min(begin + rows, count);
+                std::exception_ptr error;
+                BasicScratchBuffer<Char> out(locale);
+                FORMATSTRING_TRY {
+                    render(context, begin, end, out.stream());
+                }
+                FORMATSTRING_CATCH_ALL {
+                    error = std::current_exception();
+                }
+                lock.lock();
+
+                Chunk<Char>& slot = slots[chunk % slots.size()];
+                slot.text.assign(out.data(), out.size());
+                slot.error = error;
+                slot.ready = true;
+                rendered.notify_all();
+            }
+        }
+    };
+}
+
+template<typename Char>
+void formatstring::render_batch(std::basic_ostream<Char>& out, std::size_t count, unsigned int threads,
+                                BasicBatchRenderer<Char> render, const void* context) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // aim for a few chunks per thread so that uneven rows even out
+    std::size_t rows = std::min(std::max(count / (threads * 8), MIN_CHUNK_ROWS), MAX_CHUNK_ROWS);
+    std::size_t chunks = (count + rows - 1) / rows;
+
+    if (threads == 1 || chunks <= 1) {
+        // chunk by chunk as well, so a failing record leaves out its chunk
+        for (std::size_t begin = 0; begin < count; begin += rows) {
+            BasicScratchBuffer<Char> buffer(out.getloc());
+            render(context, begin, std::min(begin + rows, count), buffer.stream());
+            out.write(buffer.data(), buffer.size());
+        }
+        return;
+    }
+
+    if (chunks < threads) {
+        threads = (unsigned int)chunks;
+    }
+
+    Batch<Char> batch;
+    batch.render   = render;
+    batch.context  = context;
+    batch.locale   = out.getloc();
+    batch.count    = count;
+    batch.rows     = rows;
+    batch.chunks   = chunks;
+    batch.slots.resize(threads * 2);
+    batch.next     = 0;
+    batch.done     = 0;
+    batch.stopping = false;
+
+    for (Chunk<Char>& slot : batch.slots) {
+        slot.ready = false;
+    }
+
+    std::vector<std::thread> workers;
+    std::exception_ptr error;
+
+    FORMATSTRING_TRY {
+        for (unsigned int i = 0; i < threads; ++ i) {
+            workers.emplace_back(&Batch<Char>::work, &batch);
+        }
+
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        while (batch.done < chunks) {
+            Chunk<Char>& slot = batch.slots[batch.done % batch.slots.size()];
+            while (!slot.ready) {
+                batch.rendered.wait(lock);
+            }
+
+            if (slot.error) {
+                std::rethrow_exception(slot.error);
+            }
+
+            std::basic_string<Char> text;
+            text.swap(slot.text);
+            slot.ready = false;
+
+            // let workers go on while this chunk is written
+            lock.unlock();
+            out.write(text.data(), text.size());
+            lock.lock();
+
+            ++ batch.done;
+            batch.written.notify_all();
+        }
+    }
+    FORMATSTRING_CATCH_ALL {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.stopping = true;
+    }
+    batch.written.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template void formatstring::render_batch<char>(std::basic_ostream<char>& out, std::size_t count, unsigned int threads,
+                                               BasicBatchRenderer<char> render, const void* context);
+template void formatstring::render_batch<wchar_t>(std::basic_ostream<wchar_t>& out, std::size_t count, unsigned int threads,
+                                                  BasicBatchRenderer<wchar_t> render, const void* context);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template void formatstring::render_batch<char16_t>(std::basic_ostream<char16_t>& out, std::size_t count, unsigned int threads,
+                                                   BasicBatchRenderer<char16_t> render, const void* context);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template void formatstring::render_batch<char32_t>(std::basic_ostream<char32_t>& out, std::size_t count, unsigned int threads,
+                                                   BasicBatchRenderer<char32_t> render, const void* context);
+#endif
@@ -0,0 +1,302 @@
+#include "formatstring/binarylog.h"
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+
+using namespace formatstring;
+
+const char formatstring::binarylog::MAGIC[8] = {'F', 'M', 'T', 'B', 'L', 'O', 'G', '\0'};
+const std::uint32_t formatstring::binarylog::VERSION = 2;
+
+static inline std::size_t padding(std::size_t size) {
+    return (8 - size % 8) % 8;
+}
+
+// ---- writer ----
+
+template<typename Char>
+BasicCatalogFile<Char> BasicBinaryLogWriter<Char>::write_catalog(std::ostream& out, const BasicCatalogEntries<Char>& formats, std::vector<std::uint64_t>& storage) {
+    BasicCatalogWriter<Char> writer;
+    writer.add(formats);
+
+    std::ostringstream buffer;
+    writer.write(buffer);
+    const std::string& data = buffer.str();
+
+    binarylog::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, binarylog::MAGIC, sizeof(header.magic));
+    header.version      = binarylog::VERSION;
+    header.char_size    = sizeof(Char);
+    header.catalog_size = data.size();
+
+    const char zeros[8] = {0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(data.data(), data.size());
+    out.write(zeros, padding(data.size()));
+
+    // keep an aligned copy for looking up ids
+    storage.resize((data.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    std::memcpy(storage.data(), data.data(), data.size());
+
+    return BasicCatalogFile<Char>(storage.data(), data.size());
+}
+
+template<typename Char>
+BasicBinaryLogWriter<Char>::BasicBinaryLogWriter(std::ostream& out, const BasicCatalogEntries<Char>& formats) :
+    m_out(out), m_storage(), m_catalog(write_catalog(out, formats, m_storage)) {}
+
+template<typename Char>
+std::size_t BasicBinaryLogWriter<Char>::index(const std::basic_string<Char>& id) const {
+    std::size_t index = m_catalog.index(id);
+    if (index == npos) {
+        FORMATSTRING_THROW(std::out_of_range("no such id in binary log catalog"));
+    }
+    return index;
+}
+
+template<typename Char>
+void BasicBinaryLogWriter<Char>::check_index(std::size_t index) const {
+    if (index >= m_catalog.size() || index > std::numeric_limits<std::uint32_t>::max()) {
+        FORMATSTRING_THROW(std::out_of_range("no such format in binary log catalog"));
+    }
+}
+
+template<typename Char>
+void BasicBinaryLogWriter<Char>::flush_record() {
+    m_out.write(m_buffer.data(), m_buffer.size());
+}
+
+// ---- reader ----
+
+namespace {
+    // formats with other character types can't format narrow characters
+    template<typename Char, typename T>
+    inline BasicFormatter<Char> make_narrow_formatter(T value, std::true_type) {
+        return format_traits<Char,T>::make_formatter(value);
+    }
+
+    template<typename Char, typename T>
+    inline BasicFormatter<Char> make_narrow_formatter(T, std::false_type) {
+        FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad argument tag"));
+    }
+
+    template<typename Char>
+    struct DecodedValue {
+        binarylog::Tag tag;
+        union {
+            bool               b;
+            char               c;
+            Char               wc;
+            signed char        sc;
+            unsigned char      uc;
+            long long          i;
+            unsigned long long u;
+            float              f;
+            double             d;
+            long double        ld;
+        };
+        std::basic_string<Char> str;
+
+        // Rendered: the texts of the fields in order, next is the one the
+        // next field gets
+        std::vector< std::basic_string<Char> > rendered;
+        mutable std::size_t next;
+
+        BasicFormatter<Char> make_formatter() const {
+            switch (tag) {
+            case binarylog::Bool:         return format_traits<Char,bool>::make_formatter(b);
+            case binarylog::NarrowChar:   return make_narrow_formatter<Char>(c,  std::is_same<Char,char>());
+            case binarylog::WideChar:     return format_traits<Char,Char>::make_formatter(wc);
+            case binarylog::SignedChar:   return make_narrow_formatter<Char>(sc, std::is_same<Char,char>());
+            case binarylog::UnsignedChar: return make_narrow_formatter<Char>(uc, std::is_same<Char,char>());
+            case binarylog::Int:          return format_traits<Char,long long>::make_formatter(i);
+            case binarylog::UInt:         return format_traits<Char,unsigned long long>::make_formatter(u);
+            case binarylog::Float:        return format_traits<Char,float>::make_formatter(f);
+            case binarylog::Double:       return format_traits<Char,double>::make_formatter(d);
+            case binarylog::LongDouble:   return format_traits<Char,long double>::make_formatter(ld);
+            case binarylog::Rendered:
+                next = 0;
+                return [this](std::basic_ostream<Char>& out, Conversion, const BasicFormatSpec<Char>&) {
+                    const std::basic_string<Char>& text = rendered[next ++];
+                    out.write(text.data(), text.size());
+                };
+            default:                      return format_traits< Char, std::basic_string<Char> >::make_formatter(str);
+            }
+        }
+    };
+}
+
+static void read_exactly(std::istream& in, void* data, std::size_t size) {
+    if (!in.read(static_cast<char*>(data), size)) {
+        FORMATSTRING_THROW(std::runtime_error("truncated binary log"));
+    }
+}
+
+template<typename T>
+static inline T read_value(std::istream& in) {
+    T value;
+    read_exactly(in, &value, sizeof(value));
+    return value;
+}
+
+// bytes between the read position and the end of the stream, or the
+// maximum if the stream can't tell
+static std::uint64_t bytes_left(std::istream& in) {
+    const std::istream::pos_type none(-1);
+    std::istream::pos_type pos = in.tellg();
+    if (pos == none) {
+        in.clear();
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+
+    in.seekg(0, std::ios_base::end);
+    std::istream::pos_type end = in.tellg();
+    in.clear();
+    in.seekg(pos);
+    if (end == none || end < pos) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return (std::uint64_t)(end - pos);
+}
+
+// The length comes from the log, so long strings are checked against what
+// is left of the stream before anything is allocated. Streams that can't
+// tell are read in chunks, so a corrupt length fails once the stream ends.
+template<typename Char>
+static void read_string(std::istream& in, std::basic_string<Char>& str) {
+    static const std::uint64_t CHUNK = 64 * 1024;
+
+    std::uint64_t size = read_value<std::uint64_t>(in);
+    if (size > CHUNK && size > bytes_left(in) / sizeof(Char)) {
+        FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad string length"));
+    }
+
+    str.clear();
+    while (size > 0) {
+        std::size_t offset = str.size();
+        std::size_t count  = (std::size_t)(size < CHUNK ? size : CHUNK);
+        str.resize(offset + count);
+        read_exactly(in, &str[offset], count * sizeof(Char));
+        size -= count;
+    }
+}
+
+template<typename Char>
+BasicCatalogFile<Char> BasicBinaryLogReader<Char>::read_catalog(std::istream& in, std::vector<std::uint64_t>& storage) {
+    binarylog::Header header;
+    read_exactly(in, &header, sizeof(header));
+
+    if (std::memcmp(header.magic, binarylog::MAGIC, sizeof(header.magic)) != 0) {
+        FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad magic"));
+    }
+
+    if (header.version != binarylog::VERSION || header.char_size != sizeof(Char)) {
+        FORMATSTRING_THROW(std::runtime_error("invalid binary log: incompatible version or character type"));
+    }
+
+    if (header.catalog_size > bytes_left(in)) {
+        FORMATSTRING_THROW(std::runtime_error("truncated binary log"));
+    }
+
+    std::size_t size = header.catalog_size;
+    storage.resize((size + padding(size)) / sizeof(std::uint64_t));
+    read_exactly(in, storage.data(), size + padding(size));
+
+    return BasicCatalogFile<Char>(storage.data(), size);
+}
+
+template<typename Char>
+BasicBinaryLogReader<Char>::BasicBinaryLogReader(std::istream& in) :
+    m_in(in), m_storage(), m_catalog(read_catalog(in, m_storage)) {}
+
+template<typename Char>
+bool BasicBinaryLogReader<Char>::next(std::basic_ostream<Char>& out) {
+    std::uint32_t index;
+    if (!m_in.read(reinterpret_cast<char*>(&index), sizeof(index))) {
+        if (m_in.gcount() == 0) {
+            return false;
+        }
+        FORMATSTRING_THROW(std::runtime_error("truncated binary log"));
+    }
+
+    if (index >= m_catalog.size()) {
+        FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad format index"));
+    }
+
+    const BasicFormat<Char> format = m_catalog.format(index);
+    std::size_t argc = read_value<unsigned char>(m_in);
+    std::vector< DecodedValue<Char> > values(argc);
+
+    for (std::size_t arg = 0; arg < argc; ++ arg) {
+        DecodedValue<Char>& value = values[arg];
+        value.tag = (binarylog::Tag)read_value<unsigned char>(m_in);
+        switch (value.tag) {
+        case binarylog::Bool:
+        {
+            // not read as a bool, any other byte than 0 or 1 would be undefined
+            unsigned char b = read_value<unsigned char>(m_in);
+            if (b > 1) {
+                FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad bool value"));
+            }
+            value.b = b != 0;
+            break;
+        }
+
+        case binarylog::NarrowChar:   value.c  = read_value<char>(m_in); break;
+        case binarylog::WideChar:     value.wc = read_value<Char>(m_in); break;
+        case binarylog::SignedChar:   value.sc = read_value<signed char>(m_in); break;
+        case binarylog::UnsignedChar: value.uc = read_value<unsigned char>(m_in); break;
+        case binarylog::Int:          value.i  = read_value<long long>(m_in); break;
+        case binarylog::UInt:         value.u  = read_value<unsigned long long>(m_in); break;
+        case binarylog::Float:        value.f  = read_value<float>(m_in); break;
+        case binarylog::Double:       value.d  = read_value<double>(m_in); break;
+        case binarylog::LongDouble:   value.ld = read_value<long double>(m_in); break;
+
+        case binarylog::String:       read_string(m_in, value.str); break;
+
+        case binarylog::Rendered:
+        {
+            std::uint32_t count = read_value<std::uint32_t>(m_in);
+            if (count != binarylog::field_count(format.items(), arg)) {
+                FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad number of rendered fields"));
+            }
+            value.rendered.resize(count);
+            for (std::basic_string<Char>& text : value.rendered) {
+                read_string(m_in, text);
+            }
+            break;
+        }
+
+        default:
+            FORMATSTRING_THROW(std::runtime_error("invalid binary log: bad argument tag"));
+        }
+    }
+
+    BasicFormatters<Char> formatters;
+    formatters.reserve(argc);
+    for (const DecodedValue<Char>& value : values) {
+        formatters.push_back(value.make_formatter());
+    }
+
+    format.apply(out, formatters);
+    return true;
+}
+
+template class BasicBinaryLogWriter<char>;
+template class BasicBinaryLogWriter<wchar_t>;
+template class BasicBinaryLogReader<char>;
+template class BasicBinaryLogReader<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicBinaryLogWriter<char16_t>;
+template class BasicBinaryLogReader<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicBinaryLogWriter<char32_t>;
+template class BasicBinaryLogReader<char32_t>;
+#endif
@@ -0,0 +1,522 @@
+#include "formatstring/catalog.h"
+
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define FORMATSTRING_MMAP_SUPPORT 1
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+using namespace formatstring;
+
+const char formatstring::catalog::MAGIC[8] = {'F', 'M', 'T', 'C', 'A', 'T', '\0', '\0'};
+const std::uint32_t formatstring::catalog::VERSION = 1;
+const std::uint32_t formatstring::catalog::BYTE_ORDER_MARK = 0x01020304;
+
+template<typename Char>
+static inline bool is_space(Char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+// Whether count elements of size bytes at offset fit into limit bytes.
+// Written without sums, so corrupt offsets and counts can't overflow.
+static inline bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t limit) {
+    return offset <= limit && count <= (limit - offset) / size;
+}
+
+template<typename Char>
+BasicCatalogEntries<Char> formatstring::read_text_catalog(std::basic_istream<Char>& in) {
+    BasicCatalogEntries<Char> entries;
+    std::basic_string<Char> line;
+    std::size_t lineno = 0;
+
+    while (std::getline(in, line)) {
+        ++ lineno;
+
+        std::size_t pos = 0;
+        while (pos < line.size() && is_space(line[pos])) {
+            ++ pos;
+        }
+
+        if (pos == line.size() || line[pos] == '#') {
+            continue;
+        }
+
+        std::size_t eq = line.find((Char)'=', pos);
+        if (eq == std::basic_string<Char>::npos) {
+            std::string msg = "format catalog line ";
+            msg += std::to_string(lineno);
+            msg += ": expected '='";
+            FORMATSTRING_THROW(std::invalid_argument(msg));
+        }
+
+        std::size_t idend = eq;
+        while (idend > pos && is_space(line[idend - 1])) {
+            -- idend;
+        }
+
+        if (idend == pos) {
+            std::string msg = "format catalog line ";
+            msg += std::to_string(lineno);
+            msg += ": empty id";
+            FORMATSTRING_THROW(std::invalid_argument(msg));
+        }
+
+        std::size_t start = eq + 1;
+        while (start < line.size() && is_space(line[start])) {
+            ++ start;
+        }
+
+        std::size_t end = line.size();
+        if (end > start && line[end - 1] == '\r') {
+            -- end;
+        }
+
+        std::basic_string<Char> fmt;
+        fmt.reserve(end - start);
+        for (std::size_t i = start; i < end; ++ i) {
+            Char ch = line[i];
+            if (ch == '\\' && i + 1 < end) {
+                ++ i;
+                switch (line[i]) {
+                case 'n':  fmt += (Char)'\n'; break;
+                case 'r':  fmt += (Char)'\r'; break;
+                case 't':  fmt += (Char)'\t'; break;
+                case '\\': fmt += (Char)'\\'; break;
+                default:
+                    fmt += ch;
+                    fmt += line[i];
+                    break;
+                }
+            }
+            else {
+                fmt += ch;
+            }
+        }
+
+        entries.emplace_back(line.substr(pos, idend - pos), std::move(fmt));
+    }
+
+    return entries;
+}
+
+// ---- writer ----
+
+template<typename Char>
+void BasicCatalogWriter<Char>::add(const std::basic_string<Char>& id, const std::basic_string<Char>& fmt) {
+    m_entries.emplace_back(id, parse_format(fmt.data(), fmt.size()));
+}
+
+template<typename Char>
+void BasicCatalogWriter<Char>::add(const BasicCatalogEntries<Char>& entries) {
+    for (auto& entry : entries) {
+        add(entry.first, entry.second);
+    }
+}
+
+static inline std::uint64_t align(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static void write_padding(std::ostream& out, std::uint64_t from, std::uint64_t to) {
+    for (; from < to; ++ from) {
+        out.put('\0');
+    }
+}
+
+template<typename Char>
+void BasicCatalogWriter<Char>::write(std::ostream& out) const {
+    typedef BasicFormatItem<Char> Item;
+    typedef typename std::vector< std::pair< std::basic_string<Char>, BasicFormatItems<Char> > >::const_iterator Iter;
+
+    std::vector<Iter> sorted;
+    sorted.reserve(m_entries.size());
+    for (Iter it = m_entries.begin(); it != m_entries.end(); ++ it) {
+        sorted.push_back(it);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](Iter lhs, Iter rhs) { return lhs->first < rhs->first; });
+
+    for (std::size_t i = 1; i < sorted.size(); ++ i) {
+        if (sorted[i - 1]->first == sorted[i]->first) {
+            FORMATSTRING_THROW(std::invalid_argument("duplicate id in format catalog"));
+        }
+    }
+
+    // lay out the character pool: for every entry its id followed by its literals
+    std::vector<catalog::Entry> entries(sorted.size());
+    std::uint64_t item_count = 0;
+    std::uint64_t char_count = 0;
+
+    for (std::size_t i = 0; i < sorted.size(); ++ i) {
+        const BasicFormatItems<Char>& items = sorted[i]->second;
+        std::uint64_t literals = 0;
+        for (const Item& item : items) {
+            if (item.kind == Item::Literal) {
+                literals = std::max<std::uint64_t>(literals, item.offset + item.length);
+            }
+        }
+
+        catalog::Entry& entry = entries[i];
+        entry.id_offset       = char_count;
+        entry.id_size         = sorted[i]->first.size();
+        entry.items_offset    = item_count;
+        entry.item_count      = items.size();
+        entry.literals_offset = char_count + entry.id_size;
+
+        item_count += items.size();
+        char_count += entry.id_size + literals;
+    }
+
+    catalog::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, catalog::MAGIC, sizeof(header.magic));
+    header.version        = catalog::VERSION;
+    header.byte_order     = catalog::BYTE_ORDER_MARK;
+    header.char_size      = sizeof(Char);
+    header.item_size      = sizeof(Item);
+    header.count          = entries.size();
+    header.entries_offset = align(sizeof(header), alignof(catalog::Entry));
+    header.items_offset   = align(header.entries_offset + entries.size() * sizeof(catalog::Entry), alignof(Item));
+    header.item_count     = item_count;
+    header.chars_offset   = align(header.items_offset + item_count * sizeof(Item), alignof(Char));
+    header.char_count     = char_count;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(out, sizeof(header), header.entries_offset);
+
+    if (!entries.empty()) {
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(catalog::Entry));
+    }
+    write_padding(out, header.entries_offset + entries.size() * sizeof(catalog::Entry), header.items_offset);
+
+    for (Iter it : sorted) {
+        const BasicFormatItems<Char>& items = it->second;
+        if (!items.empty()) {
+            out.write(reinterpret_cast<const char*>(items.begin()), items.size() * sizeof(Item));
+        }
+    }
+    write_padding(out, header.items_offset + item_count * sizeof(Item), header.chars_offset);
+
+    for (std::size_t i = 0; i < sorted.size(); ++ i) {
+        const std::basic_string<Char>& id = sorted[i]->first;
+        out.write(reinterpret_cast<const char*>(id.data()), id.size() * sizeof(Char));
+
+        std::uint64_t literals = (i + 1 < sorted.size() ? entries[i + 1].id_offset : char_count) - entries[i].literals_offset;
+        if (literals > 0) {
+            out.write(reinterpret_cast<const char*>(sorted[i]->second.literals()), literals * sizeof(Char));
+        }
+    }
+}
+
+// ---- loader ----
+
+template<typename Char>
+BasicCatalogFile<Char>::BasicCatalogFile() noexcept :
+    m_mapping(nullptr), m_mapping_size(0), m_count(0), m_entries(nullptr), m_items(nullptr), m_chars(nullptr) {}
+
+template<typename Char>
+BasicCatalogFile<Char>::BasicCatalogFile(const void* data, std::size_t size) : BasicCatalogFile() {
+    init(data, size);
+}
+
+template<typename Char>
+BasicCatalogFile<Char>::BasicCatalogFile(BasicCatalogFile<Char>&& other) noexcept :
+    m_mapping(other.m_mapping), m_mapping_size(other.m_mapping_size), m_count(other.m_count),
+    m_entries(other.m_entries), m_items(other.m_items), m_chars(other.m_chars) {
+    other.m_mapping = nullptr;
+    other.m_mapping_size = 0;
+}
+
+template<typename Char>
+BasicCatalogFile<Char>::~BasicCatalogFile() {
+    unmap();
+}
+
+template<typename Char>
+void BasicCatalogFile<Char>::unmap() noexcept {
+    if (m_mapping) {
+#ifdef FORMATSTRING_MMAP_SUPPORT
+        munmap(m_mapping, m_mapping_size);
+#else
+        ::operator delete(m_mapping);
+#endif
+        m_mapping = nullptr;
+    }
+}
+
+template<typename Char>
+BasicCatalogFile<Char> BasicCatalogFile<Char>::open(const std::string& path) {
+    BasicCatalogFile<Char> file;
+
+#ifdef FORMATSTRING_MMAP_SUPPORT
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        FORMATSTRING_THROW(std::runtime_error("cannot open format catalog: " + path));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        FORMATSTRING_THROW(std::runtime_error("cannot stat format catalog: " + path));
+    }
+
+    std::size_t size = st.st_size;
+    void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        FORMATSTRING_THROW(std::runtime_error("cannot map format catalog: " + path));
+    }
+#else
+    // no mmap, read the whole file into one block instead
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+        FORMATSTRING_THROW(std::runtime_error("cannot open format catalog: " + path));
+    }
+    in.seekg(0, std::ios::end);
+    std::size_t size = (std::size_t)in.tellg();
+    in.seekg(0, std::ios::beg);
+    void* data = ::operator new(size);
+    if (!in.read(static_cast<char*>(data), size)) {
+        ::operator delete(data);
+        FORMATSTRING_THROW(std::runtime_error("cannot read format catalog: " + path));
+    }
+#endif
+
+    file.m_mapping = data;
+    file.m_mapping_size = size;
+    file.init(data, size);
+
+    return file;
+}
+
+template<typename Char>
+void BasicCatalogFile<Char>::init(const void* data, std::size_t size) {
+    typedef BasicFormatItem<Char> Item;
+
+    const char* bytes = static_cast<const char*>(data);
+    catalog::Header header;
+
+    if (size < sizeof(header)) {
+        FORMATSTRING_THROW(std::runtime_error("invalid format catalog: file too small"));
+    }
+
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (std::memcmp(header.magic, catalog::MAGIC, sizeof(header.magic)) != 0) {
+        FORMATSTRING_THROW(std::runtime_error("invalid format catalog: bad magic"));
+    }
+
+    if (header.version != catalog::VERSION || header.byte_order != catalog::BYTE_ORDER_MARK ||
+            header.char_size != sizeof(Char) || header.item_size != sizeof(Item)) {
+        FORMATSTRING_THROW(std::runtime_error("invalid format catalog: incompatible version, byte order or character type"));
+    }
+
+    if (header.entries_offset % alignof(catalog::Entry) != 0 ||
+            header.items_offset % alignof(Item) != 0 ||
+            header.chars_offset % alignof(Char) != 0 ||
+            reinterpret_cast<std::uintptr_t>(bytes) % alignof(Item) != 0 ||
+            !fits(header.entries_offset, header.count, sizeof(catalog::Entry), size) ||
+            !fits(header.items_offset, header.item_count, sizeof(Item), size) ||
+            !fits(header.chars_offset, header.char_count, sizeof(Char), size)) {
+        FORMATSTRING_THROW(std::runtime_error("invalid format catalog: bad section offsets"));
+    }
+
+    const catalog::Entry* entries = reinterpret_cast<const catalog::Entry*>(bytes + header.entries_offset);
+    const Item* items = reinterpret_cast<const Item*>(bytes + header.items_offset);
+
+    // bounds check once so that lookups and formatting don't have to
+    for (std::size_t i = 0; i < header.count; ++ i) {
+        const catalog::Entry& entry = entries[i];
+        if (!fits(entry.id_offset, entry.id_size, 1, header.char_count) ||
+                !fits(entry.items_offset, entry.item_count, 1, header.item_count) ||
+                entry.literals_offset > header.char_count) {
+            FORMATSTRING_THROW(std::runtime_error("invalid format catalog: bad entry"));
+        }
+
+        for (std::size_t j = 0; j < entry.item_count; ++ j) {
+            const Item& item = items[entry.items_offset + j];
+            if (item.kind == Item::Literal) {
+                if (!fits(item.offset, item.length, 1, header.char_count - entry.literals_offset)) {
+                    FORMATSTRING_THROW(std::runtime_error("invalid format catalog: bad literal"));
+                }
+            }
+            else if (item.kind != Item::Value) {
+                FORMATSTRING_THROW(std::runtime_error("invalid format catalog: bad item"));
+            }
+        }
+    }
+
+    m_count   = header.count;
+    m_entries = entries;
+    m_items   = items;
+    m_chars   = reinterpret_cast<const Char*>(bytes + header.chars_offset);
+}
+
+template<typename Char>
+BasicFormat<Char> BasicCatalogFile<Char>::format(std::size_t index) const noexcept {
+    const catalog::Entry& entry = m_entries[index];
+    return BasicFormat<Char>(BasicFormatItems<Char>(m_items + entry.items_offset, entry.item_count, m_chars + entry.literals_offset));
+}
+
+template<typename Char>
+std::size_t BasicCatalogFile<Char>::index(const Char* id, std::size_t size) const noexcept {
+    std::size_t lo = 0;
+    std::size_t hi = m_count;
+
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        const catalog::Entry& entry = m_entries[mid];
+        std::size_t n = std::min<std::size_t>(size, entry.id_size);
+        int cmp = std::char_traits<Char>::compare(m_chars + entry.id_offset, id, n);
+        if (cmp == 0) {
+            cmp = entry.id_size < size ? -1 : entry.id_size > size ? 1 : 0;
+        }
+
+        if (cmp == 0) {
+            return mid;
+        }
+        else if (cmp < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return npos;
+}
+
+template<typename Char>
+BasicFormat<Char> BasicCatalogFile<Char>::at(const Char* id, std::size_t size) const {
+    std::size_t i = index(id, size);
+    if (i == npos) {
+        FORMATSTRING_THROW(std::out_of_range("no such id in format catalog"));
+    }
+    return format(i);
+}
+
+// ---- reloadable catalog ----
+
+template<typename Char>
+BasicCatalog<Char>::BasicCatalog() : m_generation(0) {
+    m_snapshot = compile(BasicCatalogEntries<Char>(), 0);
+}
+
+template<typename Char>
+BasicCatalog<Char>::BasicCatalog(const std::string& path) : m_generation(0) {
+    load(path);
+}
+
+template<typename Char>
+BasicCatalog<Char>::BasicCatalog(const BasicCatalogEntries<Char>& entries) : m_generation(0) {
+    m_snapshot = compile(entries, 0);
+}
+
+template<typename Char>
+typename BasicCatalog<Char>::SnapshotPtr BasicCatalog<Char>::compile(const BasicCatalogEntries<Char>& entries, std::uint64_t generation) const {
+    BasicCatalogWriter<Char> writer;
+    writer.add(entries);
+
+    std::ostringstream out;
+    writer.write(out);
+    const std::string& data = out.str();
+
+    // 8 byte aligned storage, so the items can be used in place
+    std::vector<std::uint64_t> storage((data.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    std::memcpy(storage.data(), data.data(), data.size());
+
+    BasicCatalogFile<Char> file(storage.data(), data.size());
+    return SnapshotPtr(new Snapshot(std::move(file), std::move(storage), generation));
+}
+
+template<typename Char>
+void BasicCatalog<Char>::publish(SnapshotPtr snapshot) {
+    std::atomic_store(&m_snapshot, std::move(snapshot));
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+template<typename Char>
+void BasicCatalog<Char>::load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::uint64_t generation = m_generation.load(std::memory_order_relaxed) + 1;
+
+    char magic[sizeof(catalog::MAGIC)] = {0};
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in) {
+            FORMATSTRING_THROW(std::runtime_error("cannot open format catalog: " + path));
+        }
+        in.read(magic, sizeof(magic));
+    }
+
+    SnapshotPtr snapshot;
+    if (std::memcmp(magic, catalog::MAGIC, sizeof(magic)) == 0) {
+        snapshot = SnapshotPtr(new Snapshot(BasicCatalogFile<Char>::open(path), std::vector<std::uint64_t>(), generation));
+    }
+    else {
+        std::basic_ifstream<Char> in(path);
+        if (!in) {
+            FORMATSTRING_THROW(std::runtime_error("cannot open format catalog: " + path));
+        }
+        snapshot = compile(read_text_catalog(in), generation);
+    }
+
+    m_path = path;
+    publish(std::move(snapshot));
+}
+
+template<typename Char>
+void BasicCatalog<Char>::reload() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        path = m_path;
+    }
+
+    if (path.empty()) {
+        FORMATSTRING_THROW(std::logic_error("format catalog was not loaded from a file"));
+    }
+
+    load(path);
+}
+
+template<typename Char>
+void BasicCatalog<Char>::assign(const BasicCatalogEntries<Char>& entries) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    publish(compile(entries, m_generation.load(std::memory_order_relaxed) + 1));
+}
+
+template CatalogEntries read_text_catalog<char>(std::istream& in);
+template WCatalogEntries read_text_catalog<wchar_t>(std::wistream& in);
+
+template class BasicCatalogWriter<char>;
+template class BasicCatalogWriter<wchar_t>;
+template class BasicCatalogFile<char>;
+template class BasicCatalog<char>;
+template class BasicCatalogFile<wchar_t>;
+template class BasicCatalog<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template U16CatalogEntries read_text_catalog<char16_t>(std::basic_istream<char16_t>& in);
+template class BasicCatalogWriter<char16_t>;
+template class BasicCatalogFile<char16_t>;
+template class BasicCatalog<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template U32CatalogEntries read_text_catalog<char32_t>(std::basic_istream<char32_t>& in);
+template class BasicCatalogWriter<char32_t>;
+template class BasicCatalogFile<char32_t>;
+template class BasicCatalog<char32_t>;
+#endif
@@ -2,9 +2,44 @@
 #include "formatstring/exceptions.h"
 
 #include <sstream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 
 using namespace formatstring;
 
+static void default_error_handler(const char* what) {
+    std::fprintf(stderr, "formatstring: %s\n", what);
+}
+
+static std::atomic<ErrorHandler> error_handler(default_error_handler);
+
+ErrorHandler formatstring::set_error_handler(ErrorHandler handler) noexcept {
+    return error_handler.exchange(handler ? handler : default_error_handler);
+}
+
+void formatstring::fatal_error(const char* what) noexcept {
+    error_handler.load()(what);
+    std::abort();
+}
+
+const char* formatstring::format_error_message(FormatError error) noexcept {
+    switch (error) {
+    case NoFormatError:                return "no error";
+    case ExpectedNumber:               return "expected number";
+    case AfterSignAlignmentNotAllowed: return "'=' alignment not allowed in string format specifier";
+    case ThousandsSeparatorNotAllowed: return "Cannot specify ',' with this type.";
+    case AlternateFormNotAllowed:      return "Alternate form (#) not allowed in string format specifier";
+    case PrecisionNotAllowed:          return "Cannot specify '.' with this type.";
+    case ExpectedConversion:           return "expected 'r' or 's'";
+    case ExpectedClosingBrace:         return "expected '}'";
+    case CapacityExceeded:             return "format exceeds the fixed capacity";
+    case ArgumentIndexOutOfRange:      return "argument index out of range";
+    case InvalidArgumentFormat:        return "format specifier doesn't apply to the argument";
+    }
+    return "unknown error";
+}
+
 InvalidFormatArgumentException::InvalidFormatArgumentException(std::size_t index) :
     std::out_of_range(message(index)), m_index(index) {}
 
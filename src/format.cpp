@@ -1,18 +1,25 @@
 #include "formatstring/format.h"
 #include "formatstring/formatspec.h"
 #include "formatstring/exceptions.h"
+#include "formatstring/fixedformat.h"
 
-#include "strformatitem.h"
-#include "valueformatitem.h"
+#include "scan.h"
+
+#include <algorithm>
 
 using namespace formatstring;
 
 template<typename Char>
-static const Char* parse_size(const Char* ptr, std::size_t* numberptr) {
+static inline Char peek(const Char* ptr, const Char* end) {
+    return ptr < end ? *ptr : 0;
+}
+
+template<typename Char>
+static const Char* parse_size(const Char* ptr, const Char* end, std::size_t* numberptr) {
     std::size_t number = 0;
 
     // TODO: handle integer overflow
-    for (; *ptr; ++ ptr) {
+    for (; ptr < end; ++ ptr) {
         char ch = *ptr;
         if (ch < '0' || ch > '9') {
             break;
@@ -27,17 +34,19 @@ static const Char* parse_size(const Char* ptr, std::size_t* numberptr) {
 }
 
 template<typename Char>
-static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFormatSpec<Char>* spec) {
+static const Char* scan_spec(const Char* ptr, const Char* end, BasicFormatSpec<Char>* spec, FormatError* error) noexcept {
     typedef BasicFormatSpec<Char> Spec;
 
-    if (!*ptr) {
+    *error = NoFormatError;
+
+    if (ptr >= end) {
         return ptr;
     }
 
     bool precision = false;
     bool fill = false;
 
-    switch (*(ptr + 1)) {
+    switch (peek(ptr + 1, end)) {
     case '<':
         spec->alignment = Spec::Left;
         spec->fill = *ptr;
@@ -67,7 +76,7 @@ static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFo
         break;
     }
 
-    switch (*ptr) {
+    switch (peek(ptr, end)) {
     case '+':
         spec->sign = Spec::Always;
         ++ ptr;
@@ -84,12 +93,12 @@ static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFo
         break;
     }
 
-    if (*ptr == '#') {
+    if (peek(ptr, end) == '#') {
         spec->alternate = true;
         ++ ptr;
     }
 
-    if (*ptr == '0') {
+    if (peek(ptr, end) == '0') {
         if (!fill) {
             spec->alignment = Spec::AfterSign;
             spec->fill = '0';
@@ -98,23 +107,24 @@ static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFo
     }
 
     std::size_t size = 0;
-    const Char* next = parse_size(ptr, &size);
+    const Char* next = parse_size(ptr, end, &size);
     if (next != ptr) {
         spec->width = size;
         ptr = next;
     }
 
-    if (*ptr == ',') {
+    if (peek(ptr, end) == ',') {
         spec->thoudsandsSeperator = true;
         ++ ptr;
     }
 
-    if (*ptr == '.') {
+    if (peek(ptr, end) == '.') {
         ++ ptr;
-        if (!*ptr) {
-            throw InvalidFormatStringException(ptr - fmt, "expected number");
+        if (ptr >= end) {
+            *error = ExpectedNumber;
+            return ptr;
         }
-        next = parse_size(ptr, &size);
+        next = parse_size(ptr, end, &size);
         if (next != ptr) {
             spec->precision = size;
             ptr = next;
@@ -122,7 +132,7 @@ static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFo
         precision = true;
     }
 
-    Char type = *ptr;
+    Char type = peek(ptr, end);
     switch (type) {
     case 'a':
     case 'A':
@@ -221,38 +231,132 @@ static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, BasicFo
     }
 
     if (spec->alignment == Spec::AfterSign && spec->isStringType()) {
-        throw std::invalid_argument("'=' alignment not allowed in string format specifier");
+        *error = AfterSignAlignmentNotAllowed;
     }
-
-    if (spec->thoudsandsSeperator &&
+    else if (spec->thoudsandsSeperator &&
             spec->type != Spec::Generic &&
             spec->type != Spec::Dec &&
             spec->type != Spec::Exp &&
             spec->type != Spec::Fixed &&
             spec->type != Spec::General &&
             spec->type != Spec::Percentage) {
-        std::string msg = "Cannot specify ',' with '";
-        msg += (char)type;
+        *error = ThousandsSeparatorNotAllowed;
+    }
+    else if (spec->alternate && spec->isStringType()) {
+        *error = AlternateFormNotAllowed;
+    }
+    else if (precision && (!spec->isFloatType() && spec->type != Spec::Generic)) {
+        *error = PrecisionNotAllowed;
+    }
+
+    return ptr;
+}
+
+template<typename Char>
+static void throw_format_error(const Char* fmt, const Char* pos, const Char* end, FormatError error) {
+    switch (error) {
+    case ExpectedNumber:
+    case ExpectedConversion:
+    case ExpectedClosingBrace:
+        FORMATSTRING_THROW(InvalidFormatStringException(pos - fmt, format_error_message(error)));
+
+    case ThousandsSeparatorNotAllowed:
+    case PrecisionNotAllowed:
+    {
+        // the type character is right before where scanning stopped
+        std::string msg = error == ThousandsSeparatorNotAllowed ? "Cannot specify ',' with '" : "Cannot specify '.' with '";
+        msg += (char)peek(pos - 1, end);
         msg += "'.";
-        throw std::invalid_argument(msg);
+        FORMATSTRING_THROW(std::invalid_argument(msg));
     }
 
-    if (spec->alternate && spec->isStringType()) {
-        throw std::invalid_argument("Alternate form (#) not allowed in string format specifier");
+    default:
+        FORMATSTRING_THROW(std::invalid_argument(format_error_message(error)));
     }
+}
 
-    if (precision && (!spec->isFloatType() && spec->type != Spec::Generic)) {
-        std::string msg = "Cannot specify '.' with '";
-        msg += (char)type;
-        msg += "'.";
-        throw std::invalid_argument(msg);
+template<typename Char>
+static const Char* parse_spec_internal(const Char* fmt, const Char* ptr, const Char* end, BasicFormatSpec<Char>* spec) {
+    FormatError error;
+    const Char* next = scan_spec(ptr, end, spec, &error);
+
+    if (error != NoFormatError) {
+        throw_format_error(fmt, next, end, error);
     }
 
-    return ptr;
+    return next;
 }
 
+// Builds into a block from BasicFormatItems::allocate() that was sized
+// so that everything fits.
 template<typename Char>
-BasicFormatItems<Char> formatstring::parse_format(const Char* fmt) {
+struct BlockBuilder {
+    BasicFormatItems<Char>& items;
+
+    inline bool push_literal(const Char* str, std::size_t length) {
+        items.push_literal(str, length);
+        return true;
+    }
+
+    inline bool push_value(std::size_t index, Conversion conv, const BasicFormatSpec<Char>& spec) {
+        items.push_value(index, conv, spec);
+        return true;
+    }
+};
+
+// Builds into caller supplied arrays, merging adjacent literals the same way.
+template<typename Char>
+struct ArrayBuilder {
+    BasicFormatItem<Char>* items;
+    std::size_t            capacity;
+    std::size_t            size;
+    Char*                  literals;
+    std::size_t            chars;
+    std::size_t            used;
+
+    inline bool push_literal(const Char* str, std::size_t length) noexcept {
+        if (chars - used < length) {
+            return false;
+        }
+        if (size > 0 && items[size - 1].kind == BasicFormatItem<Char>::Literal) {
+            items[size - 1].length += length;
+        }
+        else if (size < capacity) {
+            BasicFormatItem<Char>& item = items[size ++];
+            item.kind   = BasicFormatItem<Char>::Literal;
+            item.conv   = NoConv;
+            item.index  = 0;
+            item.offset = used;
+            item.length = length;
+            item.spec   = BasicFormatSpec<Char>();
+        }
+        else {
+            return false;
+        }
+        std::char_traits<Char>::copy(literals + used, str, length);
+        used += length;
+        return true;
+    }
+
+    inline bool push_value(std::size_t index, Conversion conv, const BasicFormatSpec<Char>& spec) noexcept {
+        if (size >= capacity) {
+            return false;
+        }
+        BasicFormatItem<Char>& item = items[size ++];
+        item.kind   = BasicFormatItem<Char>::Value;
+        item.conv   = conv;
+        item.index  = index;
+        item.offset = 0;
+        item.length = 0;
+        item.spec   = spec;
+        return true;
+    }
+};
+
+// Parses fmt into items without throwing. Returns where parsing stopped,
+// which is the position of the error if there is one.
+template<typename Char, typename Builder>
+static const Char* scan_format(const Char* fmt, std::size_t size, Builder& items, FormatError* error) noexcept {
     // Format string similar to Python, but a bit more limited:
     // https://docs.python.org/3/library/string.html#format-string-syntax
     //
@@ -269,36 +373,47 @@ BasicFormatItems<Char> formatstring::parse_format(const Char* fmt) {
     // precision         ::=  integer
     // type              ::=  "b" | "B" | "c" | "d" | "e" | "E" | "f" | "F" | "g" | "G" | "n" | "o" | "O" | "s" | "S" | "x" | "X" | "%" | "a" | "A"
 
-    BasicFormatItems<Char> items;
-    const std::basic_string<Char> empty;
-    std::size_t currentIndex = 0;
-    std::basic_stringbuf<Char> buffer;
     const Char* ptr = fmt;
+    const Char* end = fmt + size;
+    std::size_t currentIndex = 0;
+
+    *error = NoFormatError;
+
+    while (ptr < end) {
+        // copy whole runs of literal text at once
+        const Char* brace = impl::find_brace(ptr, end);
+        if (brace != ptr) {
+            if (!items.push_literal(ptr, brace - ptr)) {
+                *error = CapacityExceeded;
+                return ptr;
+            }
+            ptr = brace;
+            if (ptr == end) {
+                break;
+            }
+        }
 
-    while (*ptr) {
         Char ch = *ptr;
 
         switch (ch) {
         case '{':
             ++ ptr;
-            ch = *ptr;
+            ch = peek(ptr, end);
             if (ch == '{') {
-                buffer.sputc(ch);
+                if (!items.push_literal(ptr, 1)) {
+                    *error = CapacityExceeded;
+                    return ptr;
+                }
             }
             else {
-                if (buffer.in_avail() > 0) {
-                    items.emplace_back(new BasicStrFormatItem<Char>(buffer.str()));
-                    buffer.str(empty);
-                }
-
                 // parse format
                 std::size_t index = currentIndex;
                 BasicFormatSpec<Char> spec;
                 Conversion conv = NoConv;
 
                 if (ch >= '0' && ch <= '9') {
-                    ptr = parse_size(ptr, &index);
-                    ch = *ptr;
+                    ptr = parse_size(ptr, end, &index);
+                    ch = peek(ptr, end);
                 }
                 else {
                     ++ currentIndex;
@@ -306,7 +421,7 @@ BasicFormatItems<Char> formatstring::parse_format(const Char* fmt) {
 
                 if (ch == '!') {
                     ++ ptr;
-                    ch = *ptr;
+                    ch = peek(ptr, end);
                     if (ch == 'r') {
                         conv = ReprConv;
                     }
@@ -314,93 +429,250 @@ BasicFormatItems<Char> formatstring::parse_format(const Char* fmt) {
                         conv = StrConv;
                     }
                     else {
-                        throw InvalidFormatStringException(ptr - fmt, "expected 'r' or 's'");
+                        *error = ExpectedConversion;
+                        return ptr;
                     }
                     ++ ptr;
-                    ch = *ptr;
+                    ch = peek(ptr, end);
                 }
 
                 if (ch == ':') {
                     ++ ptr;
-                    ptr = parse_spec_internal(fmt, ptr, &spec);
-                    ch = *ptr;
+                    ptr = scan_spec(ptr, end, &spec, error);
+                    if (*error != NoFormatError) {
+                        return ptr;
+                    }
+                    ch = peek(ptr, end);
                 }
 
                 if (ch != '}') {
-                    throw InvalidFormatStringException(ptr - fmt, "expected '}'");
+                    *error = ExpectedClosingBrace;
+                    return ptr;
                 }
 
-                items.emplace_back(new BasicValueFormatItem<Char>(index, conv, spec));
+                if (!items.push_value(index, conv, spec)) {
+                    *error = CapacityExceeded;
+                    return ptr;
+                }
             }
             break;
 
         case '}':
             ++ ptr;
-            if (*ptr == '}') {
-                buffer.sputc(ch);
+            if (peek(ptr, end) == '}') {
+                if (!items.push_literal(ptr, 1)) {
+                    *error = CapacityExceeded;
+                    return ptr;
+                }
             }
             else {
-                throw InvalidFormatStringException(ptr - fmt, "expected '}'");
+                *error = ExpectedClosingBrace;
+                return ptr;
             }
             break;
-
-        default:
-            buffer.sputc(ch);
-            break;
         }
         ++ ptr;
     }
 
-    if (buffer.in_avail() > 0) {
-        items.emplace_back(new BasicStrFormatItem<Char>(buffer.str()));
+    return ptr;
+}
+
+template<typename Char>
+BasicFormatItems<Char> formatstring::parse_format(const Char* fmt) {
+    return parse_format(fmt, std::char_traits<Char>::length(fmt));
+}
+
+template<typename Char>
+BasicFormatItems<Char> formatstring::parse_format(const Char* fmt, std::size_t size) {
+    FORMATSTRING_ALLOC_SCOPE(scope, nullptr, ParsePhase);
+#ifdef FORMATSTRING_USDT
+    ParseProbe probe(fmt, size);
+#endif
+
+    // Every replacement field adds at most one value item and terminates at
+    // most one literal item and literals can't be longer than the format
+    // string, so everything fits into a single allocation of this size.
+    std::size_t capacity = 2 * std::count(fmt, fmt + size, (Char)'{') + 1;
+    BasicFormatItems<Char> items = BasicFormatItems<Char>::allocate(capacity, size);
+    BlockBuilder<Char> builder = {items};
+
+    FormatError error;
+    const Char* pos = scan_format(fmt, size, builder, &error);
+    if (error != NoFormatError) {
+        throw_format_error(fmt, pos, fmt + size, error);
     }
 
-    return std::move(items);
+#ifdef FORMATSTRING_ALLOC_STATS
+    scope.set_key(items.begin());
+    scope.set_label(fmt, size);
+#endif
+
+#ifdef FORMATSTRING_FORMAT_STATS
+    items.set_stats(register_format_stats(fmt, size, sizeof(Char)));
+#endif
+
+#ifdef FORMATSTRING_USDT
+    probe.set_items(items.begin());
+#endif
+
+    return items;
+}
+
+template<typename Char>
+FormatError formatstring::try_parse_format(const Char* fmt, std::size_t size, BasicFormatItems<Char>* items, std::size_t* error_pos) {
+    FORMATSTRING_ALLOC_SCOPE(scope, nullptr, ParsePhase);
+#ifdef FORMATSTRING_USDT
+    ParseProbe probe(fmt, size);
+#endif
+    std::size_t capacity = 2 * std::count(fmt, fmt + size, (Char)'{') + 1;
+    BasicFormatItems<Char> parsed = BasicFormatItems<Char>::allocate(capacity, size);
+    BlockBuilder<Char> builder = {parsed};
+
+    FormatError error;
+    const Char* pos = scan_format(fmt, size, builder, &error);
+    if (error_pos) {
+        *error_pos = pos - fmt;
+    }
+    if (error == NoFormatError) {
+#ifdef FORMATSTRING_ALLOC_STATS
+        scope.set_key(parsed.begin());
+        scope.set_label(fmt, size);
+#endif
+#ifdef FORMATSTRING_FORMAT_STATS
+        parsed.set_stats(register_format_stats(fmt, size, sizeof(Char)));
+#endif
+#ifdef FORMATSTRING_USDT
+        probe.set_items(parsed.begin());
+#endif
+        items->swap(parsed);
+    }
+    return error;
+}
+
+template<typename Char>
+FormatError formatstring::parse_format_into(const Char* fmt, std::size_t size,
+                                            BasicFormatItem<Char>* items, std::size_t capacity,
+                                            Char* literals, std::size_t chars,
+                                            std::size_t* count, std::size_t* error_pos) noexcept {
+    ArrayBuilder<Char> builder = {items, capacity, 0, literals, chars, 0};
+
+    FormatError error;
+    const Char* pos = scan_format(fmt, size, builder, &error);
+    *count = error == NoFormatError ? builder.size : 0;
+    if (error_pos) {
+        *error_pos = pos - fmt;
+    }
+    return error;
 }
 
 template<typename Char>
 BasicFormatSpec<Char> formatstring::parse_spec(const Char* str) {
+    return parse_spec(str, std::char_traits<Char>::length(str));
+}
+
+template<typename Char>
+BasicFormatSpec<Char> formatstring::parse_spec(const Char* str, std::size_t size) {
     BasicFormatSpec<Char> spec;
-    parse_spec_internal(str, str, &spec);
+    parse_spec_internal(str, str, str + size, &spec);
     return std::move(spec);
 }
 
+template<typename Char>
+FormatError formatstring::try_parse_spec(const Char* str, std::size_t size, BasicFormatSpec<Char>* spec, std::size_t* parsed) noexcept {
+    FormatError error;
+    *spec = BasicFormatSpec<Char>();
+    const Char* next = scan_spec(str, str + size, spec, &error);
+    if (parsed) {
+        *parsed = next - str;
+    }
+    return error;
+}
+
 template FormatItems parse_format<char>(const char* fmt);
+template FormatItems parse_format<char>(const char* fmt, std::size_t size);
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
 template U16FormatItems parse_format<char16_t>(const char16_t* fmt);
+template U16FormatItems parse_format<char16_t>(const char16_t* fmt, std::size_t size);
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
 template U32FormatItems parse_format<char32_t>(const char32_t* fmt);
+template U32FormatItems parse_format<char32_t>(const char32_t* fmt, std::size_t size);
 #endif
 
 template WFormatItems parse_format<wchar_t>(const wchar_t* fmt);
+template WFormatItems parse_format<wchar_t>(const wchar_t* fmt, std::size_t size);
 
 template FORMATSTRING_EXPORT FormatSpec parse_spec<char>(const char* str);
+template FORMATSTRING_EXPORT FormatSpec parse_spec<char>(const char* str, std::size_t size);
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
 template FORMATSTRING_EXPORT U16FormatSpec parse_spec<char16_t>(const char16_t* str);
+template FORMATSTRING_EXPORT U16FormatSpec parse_spec<char16_t>(const char16_t* str, std::size_t size);
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
 template FORMATSTRING_EXPORT U32FormatSpec parse_spec<char32_t>(const char32_t* str);
+template FORMATSTRING_EXPORT U32FormatSpec parse_spec<char32_t>(const char32_t* str, std::size_t size);
 #endif
 
 template FORMATSTRING_EXPORT WFormatSpec parse_spec<wchar_t>(const wchar_t* str);
+template FORMATSTRING_EXPORT WFormatSpec parse_spec<wchar_t>(const wchar_t* str, std::size_t size);
+
+template FormatError try_parse_spec<char>(const char* str, std::size_t size, FormatSpec* spec, std::size_t* parsed) noexcept;
+template FormatError try_parse_spec<wchar_t>(const wchar_t* str, std::size_t size, WFormatSpec* spec, std::size_t* parsed) noexcept;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template FormatError try_parse_spec<char16_t>(const char16_t* str, std::size_t size, U16FormatSpec* spec, std::size_t* parsed) noexcept;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template FormatError try_parse_spec<char32_t>(const char32_t* str, std::size_t size, U32FormatSpec* spec, std::size_t* parsed) noexcept;
+#endif
+
+template FormatError try_parse_format<char>(const char* fmt, std::size_t size, FormatItems* items, std::size_t* error_pos);
+template FormatError try_parse_format<wchar_t>(const wchar_t* fmt, std::size_t size, WFormatItems* items, std::size_t* error_pos);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template FormatError try_parse_format<char16_t>(const char16_t* fmt, std::size_t size, U16FormatItems* items, std::size_t* error_pos);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template FormatError try_parse_format<char32_t>(const char32_t* fmt, std::size_t size, U32FormatItems* items, std::size_t* error_pos);
+#endif
+
+template FormatError parse_format_into<char>(const char* fmt, std::size_t size, FormatItem* items, std::size_t capacity, char* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+template FormatError parse_format_into<wchar_t>(const wchar_t* fmt, std::size_t size, WFormatItem* items, std::size_t capacity, wchar_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template FormatError parse_format_into<char16_t>(const char16_t* fmt, std::size_t size, U16FormatItem* items, std::size_t capacity, char16_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template FormatError parse_format_into<char32_t>(const char32_t* fmt, std::size_t size, U32FormatItem* items, std::size_t capacity, char32_t* literals, std::size_t chars, std::size_t* count, std::size_t* error_pos) noexcept;
+#endif
 
+template class BasicFormatItems<char>;
 template class BasicFormat<char>;
+template class BasicFormatRef<char>;
 template class BasicBoundFormat<char>;
 
 #ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicFormatItems<char16_t>;
 template class BasicFormat<char16_t>;
+template class BasicFormatRef<char16_t>;
 template class BasicBoundFormat<char16_t>;
 #endif
 
 #ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicFormatItems<char32_t>;
 template class BasicFormat<char32_t>;
+template class BasicFormatRef<char32_t>;
 template class BasicBoundFormat<char32_t>;
 #endif
 
+template class BasicFormatItems<wchar_t>;
 template class BasicFormat<wchar_t>;
+template class BasicFormatRef<wchar_t>;
 template class BasicBoundFormat<wchar_t>;
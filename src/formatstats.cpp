@@ -0,0 +1,391 @@
+#include "formatstring/formatstats.h"
+
+const char* formatstring::arg_kind_name(ArgKind kind) noexcept {
+    switch (kind) {
+        case BoolArg:    return "bool";
+        case CharArg:    return "char";
+        case IntegerArg: return "integer";
+        case FloatArg:   return "float";
+        case StringArg:  return "string";
+        case PointerArg: return "pointer";
+        case OtherArg:   return "other";
+        default:         return "unknown";
+    }
+}
+
+#ifdef FORMATSTRING_FORMAT_STATS
+
+#include "formatstring/format.h"
+#include "formatstring/format_traits.h"
+#include "formatstring/exceptions.h"
+#include "position.h"
+
+#include <mutex>
+#include <ostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+using namespace formatstring;
+
+namespace {
+    // format strings after that many share the counters of OTHER_LABEL
+    const std::size_t MAX_ENTRIES = 4096;
+    const char* const OTHER_LABEL = "(other formats)";
+
+    struct Entry {
+        std::string label;
+        FormatStats stats;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry*> entries; // keyed by the raw format string and the char size
+        Entry* other = nullptr;
+    };
+
+    // Format strings are looked up in a small per-thread cache by address
+    // first, so parsing the same format string again takes no lock and
+    // doesn't allocate. A hit is checked against the registered key, as the
+    // address may hold a different string by now. Formats beyond
+    // MAX_ENTRIES have no key, their slots are checked by a hash instead.
+    struct CacheSlot {
+        const void*        fmt;
+        std::size_t        bytes;
+        const std::string* key;
+        std::uint64_t      hash; // only without key
+        FormatStats*       stats;
+    };
+
+    const std::size_t CACHE_SIZE = 64;
+
+    thread_local CacheSlot cache[CACHE_SIZE] = {};
+
+    inline CacheSlot& cache_slot(const void* fmt, std::size_t bytes) noexcept {
+        std::uintptr_t hash = (std::uintptr_t)fmt;
+        hash ^= hash >> 12;
+        hash ^= bytes;
+        return cache[(hash >> 3) % CACHE_SIZE];
+    }
+
+    // FNV-1a
+    std::uint64_t content_hash(const void* fmt, std::size_t bytes, std::size_t char_size) noexcept {
+        std::uint64_t hash = 14695981039346656037ull ^ char_size;
+        const unsigned char* ptr = (const unsigned char*)fmt;
+        for (const unsigned char* end = ptr + bytes; ptr < end; ++ ptr) {
+            hash = (hash ^ *ptr) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline bool cache_hit(const CacheSlot& slot, const void* fmt, std::size_t bytes, std::size_t char_size) noexcept {
+        if (slot.fmt != fmt || slot.bytes != bytes || !slot.stats) {
+            return false;
+        }
+        if (!slot.key) {
+            return slot.hash == content_hash(fmt, bytes, char_size);
+        }
+        return slot.key->size() == bytes + 1 && (*slot.key)[bytes] == (char)char_size &&
+               std::memcmp(slot.key->data(), fmt, bytes) == 0;
+    }
+
+    // never destroyed, formats may still be used during static destruction
+    Registry& registry() {
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    // formats compiled while dumping aren't registered, so dumps don't show up in the stats
+    thread_local bool dumping = false;
+
+    class Dumping {
+    public:
+        Dumping() noexcept : m_dumping(dumping) { dumping = true; }
+        ~Dumping() { dumping = m_dumping; }
+
+    private:
+        bool m_dumping;
+    };
+
+    template<typename Char>
+    std::string ascii_label(const Char* str, std::size_t size) {
+        std::string label;
+        label.reserve(size);
+        for (const Char* end = str + size; str < end; ++ str) {
+            unsigned long ch = (unsigned long)*str;
+            label += ch < 0x80 ? (char)ch : '?';
+        }
+        return label;
+    }
+
+    FormatStatsSnapshot snapshot(const Entry& entry) {
+        FormatStatsSnapshot snapshot;
+        snapshot.label     = entry.label;
+        snapshot.applies   = entry.stats.applies.load(std::memory_order_relaxed);
+        snapshot.measured  = entry.stats.measured.load(std::memory_order_relaxed);
+        snapshot.bytes     = entry.stats.bytes.load(std::memory_order_relaxed);
+        snapshot.nanos     = entry.stats.nanos.load(std::memory_order_relaxed);
+        snapshot.max_nanos = entry.stats.max_nanos.load(std::memory_order_relaxed);
+        for (std::size_t kind = 0; kind < ArgKindCount; ++ kind) {
+            snapshot.args[kind] = entry.stats.args[kind].load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    std::string prometheus_label(const std::string& str) {
+        std::string label;
+        label.reserve(str.size());
+        for (char ch : str) {
+            switch (ch) {
+                case '\\': label += "\\\\"; break;
+                case '"':  label += "\\\""; break;
+                case '\n': label += "\\n";  break;
+                default:   label += ch;     break;
+            }
+        }
+        return label;
+    }
+
+    void dump_text(std::ostream& out, const std::vector<FormatStatsSnapshot>& snapshots) {
+        const Format header = compile("{: >10} {: >12} {: >12} {: >10} {: >10}  format\n");
+        const Format row    = compile("{: >10} {: >12} {: >12.3f} {: >10.3f} {: >10.3f}  {!r}");
+        const Format arg    = compile(" {}={}");
+
+        header.format(out, "applies", "bytes", "total ms", "mean us", "max us");
+        for (const FormatStatsSnapshot& stats : snapshots) {
+            double mean = stats.applies ? (double)stats.nanos / stats.applies / 1e3 : 0.0;
+            row.format(out, stats.applies, stats.bytes, stats.nanos / 1e6, mean, stats.max_nanos / 1e3, stats.label);
+            for (std::size_t kind = 0; kind < ArgKindCount; ++ kind) {
+                if (stats.args[kind]) {
+                    arg.format(out, arg_kind_name((ArgKind)kind), stats.args[kind]);
+                }
+            }
+            out << '\n';
+        }
+    }
+
+    void dump_prometheus(std::ostream& out, const std::vector<FormatStatsSnapshot>& snapshots) {
+        const Format help   = compile("# HELP formatstring_{} {}\n# TYPE formatstring_{} {}\n");
+        const Format sample = compile("formatstring_{}{{format=\"{}\"}} {}\n");
+        const Format arg    = compile("formatstring_args_total{{format=\"{}\",kind=\"{}\"}} {}\n");
+
+        std::vector<std::string> labels;
+        labels.reserve(snapshots.size());
+        for (const FormatStatsSnapshot& stats : snapshots) {
+            labels.push_back(prometheus_label(stats.label));
+        }
+
+        help.format(out, "applies_total", "Number of times the format was applied.", "applies_total", "counter");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            sample.format(out, "applies_total", labels[index], snapshots[index].applies);
+        }
+
+        help.format(out, "measured_applies_total", "Number of applies with a known output size.", "measured_applies_total", "counter");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            sample.format(out, "measured_applies_total", labels[index], snapshots[index].measured);
+        }
+
+        help.format(out, "bytes_total", "Output produced by the measured applies.", "bytes_total", "counter");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            sample.format(out, "bytes_total", labels[index], snapshots[index].bytes);
+        }
+
+        help.format(out, "seconds_total", "Time spent applying the format.", "seconds_total", "counter");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            sample.format(out, "seconds_total", labels[index], format("{:.9f}", snapshots[index].nanos / 1e9).str());
+        }
+
+        help.format(out, "max_seconds", "Longest single apply of the format.", "max_seconds", "gauge");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            sample.format(out, "max_seconds", labels[index], format("{:.9f}", snapshots[index].max_nanos / 1e9).str());
+        }
+
+        help.format(out, "args_total", "Arguments bound to the format by kind.", "args_total", "counter");
+        for (std::size_t index = 0; index < snapshots.size(); ++ index) {
+            for (std::size_t kind = 0; kind < ArgKindCount; ++ kind) {
+                if (snapshots[index].args[kind]) {
+                    arg.format(out, labels[index], arg_kind_name((ArgKind)kind), snapshots[index].args[kind]);
+                }
+            }
+        }
+    }
+}
+
+FormatStats::FormatStats() noexcept {
+    reset();
+}
+
+void FormatStats::reset() noexcept {
+    applies.store(0, std::memory_order_relaxed);
+    measured.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    nanos.store(0, std::memory_order_relaxed);
+    max_nanos.store(0, std::memory_order_relaxed);
+    for (auto& count : args) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+FormatStats* formatstring::register_format_stats(const void* fmt, std::size_t size, std::size_t char_size) {
+    if (dumping) {
+        return nullptr;
+    }
+
+    std::size_t bytes = size * char_size;
+    CacheSlot& slot = cache_slot(fmt, bytes);
+    if (cache_hit(slot, fmt, bytes, char_size)) {
+        return slot.stats;
+    }
+
+    std::string key((const char*)fmt, bytes);
+    key += (char)char_size;
+
+    Registry& stats = registry();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+
+    auto found = stats.entries.find(key);
+    if (found == stats.entries.end() && stats.entries.size() >= MAX_ENTRIES) {
+        if (!stats.other) {
+            stats.other = new Entry();
+            stats.other->label = OTHER_LABEL;
+        }
+        slot = {fmt, bytes, nullptr, content_hash(fmt, bytes, char_size), &stats.other->stats};
+        return slot.stats;
+    }
+
+    if (found == stats.entries.end()) {
+        found = stats.entries.emplace(std::move(key), new Entry()).first;
+        Entry* entry = found->second;
+        switch (char_size) {
+            case sizeof(char):
+                entry->label = ascii_label((const char*)fmt, size);
+                break;
+
+            case sizeof(char16_t):
+                entry->label = ascii_label((const char16_t*)fmt, size);
+                break;
+
+            default:
+                entry->label = ascii_label((const char32_t*)fmt, size);
+                break;
+        }
+    }
+
+    slot = {fmt, bytes, &found->first, 0, &found->second->stats};
+    return slot.stats;
+}
+
+template<typename Char>
+BasicFormatStatsScope<Char>::BasicFormatStatsScope(FormatStats* stats, std::basic_ostream<Char>& out) :
+    m_stats(stats), m_out(&out), m_pos(-1) {
+    if (m_stats) {
+        m_pos = impl::memory_position(out);
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+template<typename Char>
+BasicFormatStatsScope<Char>::~BasicFormatStatsScope() {
+    if (!m_stats) {
+        return;
+    }
+
+    std::uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+
+    m_stats->applies.fetch_add(1, std::memory_order_relaxed);
+    m_stats->nanos.fetch_add(nanos, std::memory_order_relaxed);
+
+    std::uint64_t max = m_stats->max_nanos.load(std::memory_order_relaxed);
+    while (nanos > max && !m_stats->max_nanos.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {}
+
+    if (m_pos >= 0) {
+        std::int64_t pos = impl::memory_position(*m_out);
+        if (pos >= m_pos) {
+            m_stats->measured.fetch_add(1, std::memory_order_relaxed);
+            m_stats->bytes.fetch_add((pos - m_pos) * sizeof(Char), std::memory_order_relaxed);
+        }
+    }
+}
+
+std::vector<FormatStatsSnapshot> formatstring::format_stats() {
+    std::vector<FormatStatsSnapshot> snapshots;
+    {
+        Registry& stats = registry();
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        snapshots.reserve(stats.entries.size() + 1);
+        for (const auto& item : stats.entries) {
+            snapshots.push_back(snapshot(*item.second));
+        }
+        if (stats.other) {
+            snapshots.push_back(snapshot(*stats.other));
+        }
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(), [](const FormatStatsSnapshot& lhs, const FormatStatsSnapshot& rhs) {
+        return lhs.nanos > rhs.nanos;
+    });
+
+    return snapshots;
+}
+
+void formatstring::reset_format_stats() noexcept {
+    Registry& stats = registry();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    for (const auto& item : stats.entries) {
+        item.second->stats.reset();
+    }
+    if (stats.other) {
+        stats.other->stats.reset();
+    }
+}
+
+void formatstring::dump_format_stats(std::ostream& out, FormatStatsDump kind) {
+    Dumping guard;
+    std::vector<FormatStatsSnapshot> snapshots = format_stats();
+
+    if (kind == PrometheusDump) {
+        dump_prometheus(out, snapshots);
+    }
+    else {
+        dump_text(out, snapshots);
+    }
+}
+
+void formatstring::write_format_stats(const std::string& path, FormatStatsDump kind) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::out | std::ios::trunc);
+        if (!out) {
+            FORMATSTRING_THROW(std::runtime_error("cannot open format stats file: " + tmp));
+        }
+        dump_format_stats(out, kind);
+        out.close();
+        if (!out) {
+            std::remove(tmp.c_str());
+            FORMATSTRING_THROW(std::runtime_error("cannot write format stats file: " + tmp));
+        }
+    }
+
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        FORMATSTRING_THROW(std::runtime_error("cannot rename format stats file to: " + path));
+    }
+}
+
+template class BasicFormatStatsScope<char>;
+template class BasicFormatStatsScope<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicFormatStatsScope<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicFormatStatsScope<char32_t>;
+#endif
+
+#endif // FORMATSTRING_FORMAT_STATS
@@ -174,9 +174,14 @@ void formatstring::repr_char(std::basic_ostream<Char>& out, Char value) {
 
 template<typename Char>
 void formatstring::repr_string(std::basic_ostream<Char>& out, const Char* value) {
+    repr_string(out, value, std::char_traits<Char>::length(value));
+}
+
+template<typename Char>
+void formatstring::repr_string(std::basic_ostream<Char>& out, const Char* value, std::size_t length) {
     impl::repr_char<Char>::write_prefix(out);
     out.put('"');
-    for (; *value; ++ value) {
+    for (const Char* end = value + length; value < end; ++ value) {
         Char ch = *value;
         switch (ch) {
         case '\0': out.put('\\'); out.put('0'); break;
@@ -191,7 +196,7 @@ void formatstring::repr_string(std::basic_ostream<Char>& out, const Char* value)
         case '?':
             // prevent trigraphs from being interpreted inside string literals
             out.put('?');
-            if (*(value + 1) == '?') {
+            if (value + 1 < end && *(value + 1) == '?') {
                 out.put('\\');
             }
             break;
@@ -261,9 +266,8 @@ void formatstring::format_integer(std::basic_ostream<Char>& out, Int value, cons
         break;
     }
 
-    std::basic_ostringstream<Char> buffer;
-
-    buffer.imbue(spec.thoudsandsSeperator ? impl::basic_grouping<Char>::thousands_grouping_locale : impl::basic_grouping<Char>::non_grouping_locale);
+    BasicScratchBuffer<Char> scratch(spec.thoudsandsSeperator ? impl::basic_grouping<Char>::thousands_grouping_locale : impl::basic_grouping<Char>::non_grouping_locale);
+    std::basic_ostream<Char>& buffer = scratch.stream();
 
     switch (spec.type) {
     case Spec::Generic:
@@ -318,15 +322,16 @@ void formatstring::format_integer(std::basic_ostream<Char>& out, Int value, cons
         break;
     }
 
-    std::basic_string<Char> num = buffer.str();
-    typename std::basic_string<Char>::size_type length = prefix.size() + num.size();
+    const Char* num = scratch.data();
+    std::size_t num_size = scratch.size();
+    std::size_t length = prefix.size() + num_size;
 
     if (length < spec.width) {
         std::size_t padding = spec.width - length;
         switch (spec.alignment) {
         case Spec::Left:
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             impl::fill(out, spec.fill, padding);
             break;
 
@@ -334,7 +339,7 @@ void formatstring::format_integer(std::basic_ostream<Char>& out, Int value, cons
         case Spec::DefaultAlignment:
             impl::fill(out, spec.fill, padding);
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             break;
 
         case Spec::Center:
@@ -342,7 +347,7 @@ void formatstring::format_integer(std::basic_ostream<Char>& out, Int value, cons
             std::size_t before = padding / 2;
             impl::fill(out, spec.fill, before);
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             impl::fill(out, spec.fill, padding - before);
             break;
         }
@@ -350,18 +355,18 @@ void formatstring::format_integer(std::basic_ostream<Char>& out, Int value, cons
         case Spec::AfterSign:
             out.write(prefix.c_str(), prefix.size());
             if (spec.thoudsandsSeperator && spec.fill == '0') {
-                impl::sepfill(out, padding, num.size());
+                impl::sepfill(out, padding, num_size);
             }
             else {
                 impl::fill(out, spec.fill, padding);
             }
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             break;
         }
     }
     else {
         out.write(prefix.c_str(), prefix.size());
-        out.write(num.c_str(), num.size());
+        out.write(num, num_size);
     }
 }
 
@@ -370,7 +375,7 @@ template<typename Float>
 inline std::string format_hexfloat(Float value, const FormatSpec& spec) {
     if (spec.alignment == FormatSpec::AfterSign) {
         if (spec.width > 3 && spec.fill != '0') {
-            throw std::runtime_error("unsupported hexfloat format for snprintf fallback");
+            FORMATSTRING_THROW(std::runtime_error("unsupported hexfloat format for snprintf fallback"));
         }
 
         const char *fmt = std::is_same<Float,long double>::value ?
@@ -380,7 +385,7 @@ inline std::string format_hexfloat(Float value, const FormatSpec& spec) {
         std::vector<char> buf(n, '\0');
         int count = std::snprintf(buf.data(), n, fmt, spec.width, spec.precision, value);
         if (count < 2 || count >= n) {
-            throw std::runtime_error("unexpected snprintf fail while processing hexfloat format");
+            FORMATSTRING_THROW(std::runtime_error("unexpected snprintf fail while processing hexfloat format"));
         }
         return buf.data();
     }
@@ -392,7 +397,7 @@ inline std::string format_hexfloat(Float value, const FormatSpec& spec) {
     std::vector<char> buf(n, '\0');
     int count = std::snprintf(buf.data(), n, fmt, spec.precision, value);
     if (count < 2 || count >= n) {
-        throw std::runtime_error("unexpected snprintf fail while processing hexfloat format");
+        FORMATSTRING_THROW(std::runtime_error("unexpected snprintf fail while processing hexfloat format"));
     }
     return buf.data();
 }
@@ -401,7 +406,7 @@ template<typename Float>
 inline std::wstring format_hexfloat(Float value, const WFormatSpec& spec) {
     if (spec.alignment == WFormatSpec::AfterSign) {
         if (spec.width > 3 && spec.fill != L'0') {
-            throw std::runtime_error("unsupported hexfloat format for swprintf fallback");
+            FORMATSTRING_THROW(std::runtime_error("unsupported hexfloat format for swprintf fallback"));
         }
 
         const wchar_t *fmt = std::is_same<Float,long double>::value ?
@@ -411,7 +416,7 @@ inline std::wstring format_hexfloat(Float value, const WFormatSpec& spec) {
         std::vector<wchar_t> buf(n, '\0');
         int count = std::swprintf(buf.data(), n, fmt, spec.width, spec.precision, value);
         if (count < 2 || count >= n) {
-            throw std::runtime_error("unexpected printf fail while processing hexfloat format");
+            FORMATSTRING_THROW(std::runtime_error("unexpected printf fail while processing hexfloat format"));
         }
         return buf.data();
     }
@@ -423,7 +428,7 @@ inline std::wstring format_hexfloat(Float value, const WFormatSpec& spec) {
     std::vector<wchar_t> buf(n, '\0');
     int count = std::swprintf(buf.data(), n, fmt, spec.precision, value);
     if (count < 2 || count >= n) {
-        throw std::runtime_error("unexpected printf fail while processing hexfloat format");
+        FORMATSTRING_THROW(std::runtime_error("unexpected printf fail while processing hexfloat format"));
     }
     return buf.data();
 }
@@ -433,7 +438,7 @@ template<typename Float>
 inline std::basic_string<char16_t> format_hexfloat(Float value, const U16FormatSpec& spec) {
     (void)value;
     (void)spec;
-    throw std::runtime_error("STL implementation does not support std::ios::hexfloat.");
+    FORMATSTRING_THROW(std::runtime_error("STL implementation does not support std::ios::hexfloat."));
 }
 #endif
 
@@ -442,7 +447,7 @@ template<typename Float>
 inline std::basic_string<char32_t> format_hexfloat(Float value, const U32FormatSpec& spec) {
     (void)value;
     (void)spec;
-    throw std::runtime_error("STL implementation does not support std::ios::hexfloat.");
+    FORMATSTRING_THROW(std::runtime_error("STL implementation does not support std::ios::hexfloat."));
 }
 #endif
 #endif
@@ -452,7 +457,7 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
     typedef BasicFormatSpec<Char> Spec;
 
     if (!spec.isFloatType() && spec.type != Spec::Generic) {
-        throw std::invalid_argument("Cannot use floating point numbers with non-decimal format specifier.");
+        FORMATSTRING_THROW(std::invalid_argument("Cannot use floating point numbers with non-decimal format specifier."));
     }
 
     bool negative = std::signbit(value);
@@ -476,46 +481,44 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
         break;
     }
 
-    std::basic_string<Char> num;
+    BasicScratchBuffer<Char> scratch(spec.thoudsandsSeperator ? impl::basic_grouping<Char>::thousands_grouping_locale : impl::basic_grouping<Char>::non_grouping_locale);
+    std::basic_ostream<Char>& buffer = scratch.stream();
 
     if (std::isnan(abs)) {
         if (spec.upperCase) {
-            Char buffer[] = {'N', 'A', 'N', 0};
-            num = buffer;
+            Char name[] = {'N', 'A', 'N'};
+            buffer.write(name, 3);
         }
         else {
-            Char buffer[] = {'n', 'a', 'n', 0};
-            num = buffer;
+            Char name[] = {'n', 'a', 'n'};
+            buffer.write(name, 3);
         }
 
         if (spec.type == Spec::Percentage) {
-            num += (Char)'%';
+            buffer.put('%');
         }
     }
     else if (std::isinf(abs)) {
         if (spec.upperCase) {
-            Char buffer[] = {'I', 'N', 'F', 0};
-            num = buffer;
+            Char name[] = {'I', 'N', 'F'};
+            buffer.write(name, 3);
         }
         else {
-            Char buffer[] = {'i', 'n', 'f', 0};
-            num = buffer;
+            Char name[] = {'i', 'n', 'f'};
+            buffer.write(name, 3);
         }
 
         if (spec.type == Spec::Percentage) {
-            num += (Char)'%';
+            buffer.put('%');
         }
     }
 #if !defined(FORMATSTRING_IOS_HEXFLOAT_SUPPORT) && defined(FORMATSTRING_PRINTF_HEXFLOAT_SUPPORT)
     else if (spec.type == Spec::HexFloat) {
-        num = format_hexfloat(abs, spec);
+        std::basic_string<Char> hex = format_hexfloat(abs, spec);
+        buffer.write(hex.c_str(), hex.size());
     }
 #endif
     else {
-        std::basic_ostringstream<Char> buffer;
-
-        buffer.imbue(spec.thoudsandsSeperator ? impl::basic_grouping<Char>::thousands_grouping_locale : impl::basic_grouping<Char>::non_grouping_locale);
-
         if (spec.upperCase) {
             buffer.setf(std::ios::uppercase);
         }
@@ -565,24 +568,24 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
             buffer << abs;
             break;
 #else
-            throw std::runtime_error("STL implementation does not support std::ios::hexfloat.");
+            FORMATSTRING_THROW(std::runtime_error("STL implementation does not support std::ios::hexfloat."));
 #endif
 
         default:
             break;
         }
-
-        num = buffer.str();
     }
 
-    typename std::basic_string<Char>::size_type length = prefix.size() + num.size();
+    const Char* num = scratch.data();
+    std::size_t num_size = scratch.size();
+    std::size_t length = prefix.size() + num_size;
 
     if (length < spec.width) {
         std::size_t padding = spec.width - length;
         switch (spec.alignment) {
         case Spec::Left:
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             impl::fill(out, spec.fill, padding);
             break;
 
@@ -590,7 +593,7 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
         case Spec::DefaultAlignment:
             impl::fill(out, spec.fill, padding);
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             break;
 
         case Spec::Center:
@@ -598,7 +601,7 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
             std::size_t before = padding / 2;
             impl::fill(out, spec.fill, before);
             out.write(prefix.c_str(), prefix.size());
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             impl::fill(out, spec.fill, padding - before);
             break;
         }
@@ -606,40 +609,48 @@ void formatstring::format_float(std::basic_ostream<Char>& out, Float value, cons
         case Spec::AfterSign:
             out.write(prefix.c_str(), prefix.size());
             if (spec.thoudsandsSeperator && spec.fill == '0' && std::isfinite(abs)) {
-                Char chars[] = { (Char)'.', (Char)'e', 0 };
+                Char chars[] = { (Char)'.', (Char)'e' };
                 if (spec.upperCase) {
                     chars[1] = (Char)'E';
                 }
-                std::size_t pos = num.find_first_of(chars);
-                impl::sepfill(out, padding, pos == std::basic_string<Char>::npos ? num.size() : pos);
+                std::size_t pos = 0;
+                while (pos < num_size && num[pos] != chars[0] && num[pos] != chars[1]) {
+                    ++ pos;
+                }
+                impl::sepfill(out, padding, pos);
             }
             else {
                 impl::fill(out, spec.fill, padding);
             }
-            out.write(num.c_str(), num.size());
+            out.write(num, num_size);
             break;
         }
     }
     else {
         out.write(prefix.c_str(), prefix.size());
-        out.write(num.c_str(), num.size());
+        out.write(num, num_size);
     }
 }
 
 template<typename Char>
 void formatstring::format_string(std::basic_ostream<Char>& out, const Char value[], const BasicFormatSpec<Char>& spec) {
+    format_string(out, value, std::char_traits<Char>::length(value), spec);
+}
+
+template<typename Char>
+void formatstring::format_string(std::basic_ostream<Char>& out, const Char value[], std::size_t length, const BasicFormatSpec<Char>& spec) {
     typedef BasicFormatSpec<Char> Spec;
 
     if (spec.sign != Spec::DefaultSign) {
-        throw std::invalid_argument("Sign not allowed with string or character");
+        FORMATSTRING_THROW(std::invalid_argument("Sign not allowed with string or character"));
     }
 
     if (spec.thoudsandsSeperator) {
-        throw std::invalid_argument("Cannot specify ',' for string");
+        FORMATSTRING_THROW(std::invalid_argument("Cannot specify ',' for string"));
     }
 
     if (spec.alternate && spec.type != Spec::Character) {
-        throw std::invalid_argument("Alternate form (#) not allowed in string format specifier");
+        FORMATSTRING_THROW(std::invalid_argument("Alternate form (#) not allowed in string format specifier"));
     }
 
     switch (spec.type) {
@@ -648,15 +659,14 @@ void formatstring::format_string(std::basic_ostream<Char>& out, const Char value
         break;
 
     default:
-        throw std::invalid_argument("Invalid format specifier for string or character");
+        FORMATSTRING_THROW(std::invalid_argument("Invalid format specifier for string or character"));
     }
 
-    std::size_t length = std::char_traits<Char>::length(value);
     if (spec.width > 0 && length < (std::size_t)spec.width) {
         std::size_t padding = spec.width - length;
         switch (spec.alignment) {
         case Spec::AfterSign:
-            throw std::invalid_argument("'=' alignment not allowed in string or character format specifier");
+            FORMATSTRING_THROW(std::invalid_argument("'=' alignment not allowed in string or character format specifier"));
 
         case Spec::Left:
         case Spec::DefaultAlignment:
@@ -702,7 +712,9 @@ template void repr_char<char>(std::ostream& out, char value);
 template void repr_char<wchar_t>(std::wostream& out, wchar_t value);
 
 template void repr_string<char>(std::ostream& out, const char* value);
+template void repr_string<char>(std::ostream& out, const char* value, std::size_t length);
 template void repr_string<wchar_t>(std::wostream& out, const wchar_t* value);
+template void repr_string<wchar_t>(std::wostream& out, const wchar_t* value, std::size_t length);
 
 template void format_bool<char>(std::ostream& out, bool value, const FormatSpec& spec);
 template void format_bool<wchar_t>(std::wostream& out, bool value, const WFormatSpec& spec);
@@ -711,7 +723,9 @@ template void format_int_char<char>(std::ostream& out, std::char_traits<char>::i
 template void format_int_char<wchar_t>(std::wostream& out, std::char_traits<wchar_t>::int_type value, const WFormatSpec& spec);
 
 template void format_string<char>(std::ostream& out, const char value[], const FormatSpec& spec);
+template void format_string<char>(std::ostream& out, const char value[], std::size_t length, const FormatSpec& spec);
 template void format_string<wchar_t>(std::wostream& out, const wchar_t value[], const WFormatSpec& spec);
+template void format_string<wchar_t>(std::wostream& out, const wchar_t value[], std::size_t length, const WFormatSpec& spec);
 
 template void format_float<char,float>(std::ostream& out, float value, const FormatSpec& spec);
 template void format_float<wchar_t,float>(std::wostream& out, float value, const WFormatSpec& spec);
@@ -757,11 +771,13 @@ const std::locale impl::basic_grouping<char>::thousands_grouping_locale(std::loc
 template void repr_bool<char16_t>(std::basic_ostream<char16_t>& out, bool value);
 template void repr_char<char16_t>(std::basic_ostream<char16_t>& out, char16_t value);
 template void repr_string<char16_t>(std::basic_stream<char16_t>& out, const char16_t* value);
+template void repr_string<char16_t>(std::basic_stream<char16_t>& out, const char16_t* value, std::size_t length);
 
 template void format_bool<char16_t>(std::basic_stream<char16_t>& out, bool value, const U16FormatSpec& spec);
 
 template void format_int_char<char16_t>(std::basic_ostream<char16_t>& out, std::char_traits<char16_t>::int_type value, const U16FormatSpec& spec);
 template void format_string<char16_t>(std::basic_ostream<char16_t>& out, const char16_t value[], const U16FormatSpec& spec);
+template void format_string<char16_t>(std::basic_ostream<char16_t>& out, const char16_t value[], std::size_t length, const U16FormatSpec& spec);
 
 template void format_float<char16_t,float>(std::basic_ostream<char16_t>& out, float value, const U16FormatSpec& spec);
 template void format_float<char16_t,double>(std::basic_ostream<char16_t>& out, double value, const U16FormatSpec& spec);
@@ -790,11 +806,13 @@ const std::locale impl::basic_grouping<char16_t>::thousands_grouping_locale(std:
 template void repr_bool<char32_t>(std::basic_ostream<char32_t>& out, bool value);
 template void repr_char<char32_t>(std::basic_ostream<char32_t>& out, char32_t value);
 template void repr_string<char32_t>(std::basic_stream<char32_t>& out, const char32_t* value);
+template void repr_string<char32_t>(std::basic_stream<char32_t>& out, const char32_t* value, std::size_t length);
 
 template void format_bool<char32_t>(std::basic_stream<char32_t>& out, bool value, const U32FormatSpec& spec);
 
 template void format_int_char<char32_t>(std::basic_ostream<char32_t>& out, std::char_traits<char32_t>::int_type value, const U32FormatSpec& spec);
 template void format_string<char32_t>(std::basic_ostream<char32_t>& out, const char32_t value[], const U32FormatSpec& spec);
+template void format_string<char32_t>(std::basic_ostream<char32_t>& out, const char32_t value[], std::size_t length, const U32FormatSpec& spec);
 
 template void format_float<char32_t,float>(std::basic_ostream<char32_t>& out, float value, const U32FormatSpec& spec);
 template void format_float<char32_t,double>(std::basic_ostream<char32_t>& out, double value, const U32FormatSpec& spec);
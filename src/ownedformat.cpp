@@ -0,0 +1,51 @@
+#include "formatstring/ownedformat.h"
+#include "formatstring/scratch.h"
+
+using namespace formatstring;
+
+template<typename Char>
+void BasicOwnedFormat<Char>::write_into(std::basic_ostream<Char>& out) const {
+    const Arg* args = reinterpret_cast<const Arg*>(m_record);
+
+    BasicFormatters<Char> formatters;
+    formatters.reserve(m_argc);
+    for (std::size_t i = 0; i < m_argc; ++ i) {
+        formatters.push_back(args[i].make_formatter(m_record + args[i].offset));
+    }
+
+    m_format.apply(out, formatters);
+}
+
+template<typename Char>
+std::basic_string<Char> BasicOwnedFormat<Char>::str() const {
+    BasicScratchBuffer<Char> buffer;
+    write_into(buffer.stream());
+    return buffer.str();
+}
+
+template<typename Char>
+void BasicOwnedFormat<Char>::clear() noexcept {
+    if (m_record) {
+        Arg* args = reinterpret_cast<Arg*>(m_record);
+        for (std::size_t i = 0; i < m_argc; ++ i) {
+            if (args[i].destroy) {
+                args[i].destroy(m_record + args[i].offset);
+            }
+        }
+        ::operator delete(m_record);
+        m_record = nullptr;
+    }
+    m_size = 0;
+    m_argc = 0;
+}
+
+template class BasicOwnedFormat<char>;
+template class BasicOwnedFormat<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicOwnedFormat<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicOwnedFormat<char32_t>;
+#endif
@@ -0,0 +1,21 @@
+#ifndef FORMATSTRING_POSITION_H
+#define FORMATSTRING_POSITION_H
+#pragma once
+
+#include <iosfwd>
+#include <cstdint>
+
+namespace formatstring {
+    namespace impl {
+
+        // The write position of out if it writes to memory, that is to a
+        // scratch buffer or a std::basic_stringbuf, and -1 otherwise.
+        // Unlike tellp() it never flushes or seeks a file, so it can be
+        // called around every apply (see scratch.cpp).
+        template<typename Char>
+        std::int64_t memory_position(std::basic_ostream<Char>& out);
+
+    }
+}
+
+#endif // FORMATSTRING_POSITION_H
@@ -0,0 +1,58 @@
+#include "formatstring/print.h"
+#include "formatstring/scratch.h"
+
+#include <ostream>
+#include <system_error>
+#include <cerrno>
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+#   include <unistd.h>
+#endif
+
+using namespace formatstring;
+
+void PrintTarget::write(const void* data, std::size_t size) const {
+    if (m_file) {
+        if (std::fwrite(data, 1, size, m_file) != size) {
+            FORMATSTRING_THROW(std::system_error(errno, std::generic_category(), "fwrite"));
+        }
+        return;
+    }
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t count = ::write(m_fd, bytes, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FORMATSTRING_THROW(std::system_error(errno, std::generic_category(), "write"));
+        }
+        bytes += count;
+        size  -= count;
+    }
+#endif
+}
+
+template<typename Char>
+void formatstring::print_items(PrintTarget target, const BasicFormatItems<Char>& items,
+                               const BasicFormatters<Char>& formatters, bool newline) {
+    BasicScratchBuffer<Char> buffer;
+    items.apply(buffer.stream(), formatters);
+    if (newline) {
+        buffer.stream().put('\n');
+    }
+    target.write(buffer.data(), buffer.size() * sizeof(Char));
+}
+
+template void formatstring::print_items<char>(PrintTarget target, const FormatItems& items, const Formatters& formatters, bool newline);
+template void formatstring::print_items<wchar_t>(PrintTarget target, const WFormatItems& items, const WFormatters& formatters, bool newline);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template void formatstring::print_items<char16_t>(PrintTarget target, const U16FormatItems& items, const U16Formatters& formatters, bool newline);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template void formatstring::print_items<char32_t>(PrintTarget target, const U32FormatItems& items, const U32Formatters& formatters, bool newline);
+#endif
@@ -0,0 +1,93 @@
+#include "formatstring/probes.h"
+
+#ifdef FORMATSTRING_USDT
+
+#include <ostream>
+
+#include "position.h"
+
+// the probes are guarded by semaphores, which the tracer increments while
+// it is attached, so nothing is measured while nobody is listening
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define FORMATSTRING_SEMAPHORE(name) \
+    __extension__ unsigned short formatstring_##name##_semaphore __attribute__((unused)) __attribute__((section(".probes")))
+
+#define FORMATSTRING_PROBE_ENABLED(name) __builtin_expect(formatstring_##name##_semaphore, 0)
+
+FORMATSTRING_SEMAPHORE(parse__start);
+FORMATSTRING_SEMAPHORE(parse__done);
+FORMATSTRING_SEMAPHORE(bind);
+FORMATSTRING_SEMAPHORE(apply__start);
+FORMATSTRING_SEMAPHORE(apply__done);
+
+using namespace formatstring;
+
+namespace {
+    // 0 if the tracer attached after start was taken
+    inline std::uint64_t elapsed(std::chrono::steady_clock::time_point start) noexcept {
+        if (start == std::chrono::steady_clock::time_point()) {
+            return 0;
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void formatstring::probe_bind(const void* items, std::size_t args) noexcept {
+    DTRACE_PROBE2(formatstring, bind, items, args);
+}
+
+ParseProbe::ParseProbe(const void* fmt, std::size_t size) noexcept :
+    m_fmt(fmt), m_items(nullptr) {
+    DTRACE_PROBE2(formatstring, parse__start, fmt, size);
+    if (FORMATSTRING_PROBE_ENABLED(parse__done)) {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+ParseProbe::~ParseProbe() {
+    if (FORMATSTRING_PROBE_ENABLED(parse__done)) {
+        std::uint64_t nanos = elapsed(m_start);
+        DTRACE_PROBE3(formatstring, parse__done, m_fmt, m_items, nanos);
+    }
+}
+
+template<typename Char>
+BasicApplyProbe<Char>::BasicApplyProbe(const void* items, std::basic_ostream<Char>& out) :
+    m_items(items), m_out(&out), m_pos(-1) {
+    DTRACE_PROBE1(formatstring, apply__start, items);
+    if (FORMATSTRING_PROBE_ENABLED(apply__done)) {
+        m_pos = impl::memory_position(out);
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+template<typename Char>
+BasicApplyProbe<Char>::~BasicApplyProbe() {
+    if (FORMATSTRING_PROBE_ENABLED(apply__done)) {
+        std::uint64_t nanos = elapsed(m_start);
+        std::int64_t length = -1;
+        if (m_pos >= 0) {
+            std::int64_t pos = impl::memory_position(*m_out);
+            if (pos >= m_pos) {
+                length = pos - m_pos;
+            }
+        }
+        DTRACE_PROBE3(formatstring, apply__done, m_items, length, nanos);
+    }
+}
+
+template class BasicApplyProbe<char>;
+template class BasicApplyProbe<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicApplyProbe<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicApplyProbe<char32_t>;
+#endif
+
+#endif // FORMATSTRING_USDT
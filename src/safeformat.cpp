@@ -0,0 +1,473 @@
+#include "formatstring/safeformat.h"
+#include "formatstring/formatspec.h"
+#include "formatstring/formatitem.h"
+
+#include <cstdint>
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+#   include <cerrno>
+#   include <unistd.h>
+#endif
+
+using namespace formatstring;
+
+namespace {
+    // Nothing in here may allocate, lock, throw or use the C or C++ stream
+    // libraries, because it is meant to be called from signal handlers.
+
+    class Output {
+    public:
+        Output(char* buffer, std::size_t size) noexcept :
+            m_buffer(buffer), m_pos(0), m_capacity(size ? size - 1 : 0) {}
+
+        inline void put(char ch) noexcept {
+            if (m_pos < m_capacity) {
+                m_buffer[m_pos ++] = ch;
+            }
+        }
+
+        inline void write(const char* str, std::size_t length) noexcept {
+            for (std::size_t i = 0; i < length; ++ i) {
+                put(str[i]);
+            }
+        }
+
+        inline void fill(char ch, std::size_t count) noexcept {
+            for (std::size_t i = 0; i < count; ++ i) {
+                put(ch);
+            }
+        }
+
+        inline std::size_t finish() noexcept {
+            if (m_buffer) {
+                m_buffer[m_pos] = '\0';
+            }
+            return m_pos;
+        }
+
+    private:
+        char*       m_buffer;
+        std::size_t m_pos;
+        std::size_t m_capacity;
+    };
+
+    inline std::size_t string_length(const char* str) noexcept {
+        const char* ptr = str;
+        while (*ptr) {
+            ++ ptr;
+        }
+        return ptr - str;
+    }
+
+    inline const char* escape(char ch) noexcept {
+        switch (ch) {
+        case '\a': return "\\a";
+        case '\b': return "\\b";
+        case '\t': return "\\t";
+        case '\n': return "\\n";
+        case '\v': return "\\v";
+        case '\f': return "\\f";
+        case '\r': return "\\r";
+        case '"':  return "\\\"";
+        case '\\': return "\\\\";
+        default:   return nullptr;
+        }
+    }
+
+    // same escapes as repr_string(), counted or written
+    std::size_t repr_string(Output* out, const char* value) noexcept {
+        std::size_t length = 2;
+        if (out) out->put('"');
+        for (; *value; ++ value) {
+            char ch = *value;
+            const char* esc = escape(ch);
+            if (esc) {
+                length += 2;
+                if (out) out->write(esc, 2);
+            }
+            else if (ch == '?' && *(value + 1) == '?') {
+                // prevent trigraphs from being interpreted inside string literals
+                length += 2;
+                if (out) out->write("?\\", 2);
+            }
+            else {
+                length += 1;
+                if (out) out->put(ch);
+            }
+        }
+        if (out) out->put('"');
+        return length;
+    }
+
+    void pad_before(Output& out, const FormatSpec& spec, std::size_t padding, bool numeric) noexcept {
+        switch (spec.alignment) {
+        case FormatSpec::Right:
+            out.fill(spec.fill, padding);
+            break;
+
+        case FormatSpec::Center:
+            out.fill(spec.fill, padding / 2);
+            break;
+
+        case FormatSpec::DefaultAlignment:
+            if (numeric) {
+                out.fill(spec.fill, padding);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void pad_after(Output& out, const FormatSpec& spec, std::size_t padding, bool numeric) noexcept {
+        switch (spec.alignment) {
+        case FormatSpec::Left:
+            out.fill(spec.fill, padding);
+            break;
+
+        case FormatSpec::Center:
+            out.fill(spec.fill, padding - padding / 2);
+            break;
+
+        case FormatSpec::DefaultAlignment:
+            if (!numeric) {
+                out.fill(spec.fill, padding);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bool write_string(Output& out, const char* value, Conversion conv, const FormatSpec& spec) noexcept {
+        if (spec.sign != FormatSpec::DefaultSign || spec.thoudsandsSeperator || spec.alternate ||
+                spec.alignment == FormatSpec::AfterSign ||
+                (spec.type != FormatSpec::Generic && spec.type != FormatSpec::String)) {
+            return false;
+        }
+
+        if (!value) {
+            value = "(null)";
+            conv = NoConv;
+        }
+
+        std::size_t length = conv == ReprConv ? repr_string(nullptr, value) : string_length(value);
+        std::size_t padding = spec.width > 0 && length < (std::size_t)spec.width ? spec.width - length : 0;
+
+        pad_before(out, spec, padding, false);
+        if (conv == ReprConv) {
+            repr_string(&out, value);
+        }
+        else {
+            out.write(value, length);
+        }
+        pad_after(out, spec, padding, false);
+        return true;
+    }
+
+    bool write_integer(Output& out, bool negative, unsigned long long abs, const FormatSpec& spec) noexcept {
+        // sign and base prefix
+        char prefix[3];
+        std::size_t prefix_size = 0;
+
+        switch (spec.sign) {
+        case FormatSpec::NegativeOnly:
+        case FormatSpec::DefaultSign:
+            if (negative) {
+                prefix[prefix_size ++] = '-';
+            }
+            break;
+
+        case FormatSpec::Always:
+            prefix[prefix_size ++] = negative ? '-' : '+';
+            break;
+
+        case FormatSpec::SpaceForPositive:
+            prefix[prefix_size ++] = negative ? '-' : ' ';
+            break;
+        }
+
+        unsigned int base;
+        char prefix_char;
+        switch (spec.type) {
+        case FormatSpec::Generic:
+        case FormatSpec::Dec:
+            base = 10;
+            prefix_char = 0;
+            break;
+
+        case FormatSpec::Bin:
+            base = 2;
+            prefix_char = spec.upperCase ? 'B' : 'b';
+            break;
+
+        case FormatSpec::Oct:
+            base = 8;
+            prefix_char = spec.upperCase ? 'O' : 'o';
+            break;
+
+        case FormatSpec::Hex:
+            base = 16;
+            prefix_char = spec.upperCase ? 'X' : 'x';
+            break;
+
+        default:
+            return false;
+        }
+
+        if (spec.alternate && prefix_char) {
+            prefix[prefix_size ++] = '0';
+            prefix[prefix_size ++] = prefix_char;
+        }
+
+        // digits are generated backwards from the end of the buffer,
+        // 64 binary digits are the most there can be
+        char digits[96];
+        char* num = digits + sizeof(digits);
+        const char* chars = spec.upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+        bool group = base == 10 && spec.thoudsandsSeperator;
+        unsigned int count = 0;
+        do {
+            if (group && count > 0 && count % 3 == 0) {
+                *-- num = ',';
+            }
+            *-- num = chars[abs % base];
+            abs /= base;
+            ++ count;
+        } while (abs);
+
+        std::size_t num_size = digits + sizeof(digits) - num;
+        std::size_t length = prefix_size + num_size;
+        std::size_t padding = spec.width > 0 && length < (std::size_t)spec.width ? spec.width - length : 0;
+
+        if (spec.alignment == FormatSpec::AfterSign) {
+            out.write(prefix, prefix_size);
+            out.fill(spec.fill, padding);
+            out.write(num, num_size);
+        }
+        else {
+            pad_before(out, spec, padding, true);
+            out.write(prefix, prefix_size);
+            out.write(num, num_size);
+            pad_after(out, spec, padding, true);
+        }
+        return true;
+    }
+
+    bool write_char(Output& out, char value, const FormatSpec& spec) noexcept {
+        char str[2] = {value, 0};
+        FormatSpec strspec = spec;
+        strspec.type = FormatSpec::String;
+        return write_string(out, str, NoConv, strspec);
+    }
+
+    bool write_arg(Output& out, const SafeArg& arg, Conversion conv, const FormatSpec& spec) noexcept {
+        switch (arg.kind) {
+        case SafeArg::Bool:
+            if (spec.type == FormatSpec::Generic || spec.type == FormatSpec::String) {
+                return write_string(out, arg.value.b ? "true" : "false", NoConv, spec);
+            }
+            return write_integer(out, false, arg.value.b ? 1 : 0, spec);
+
+        case SafeArg::Char:
+            if (conv == ReprConv) {
+                // as repr_char() would, but without the padding as that
+                // isn't worth another counting pass
+                const char* esc = arg.value.c == '"' ? nullptr : escape(arg.value.c);
+                out.put('\'');
+                if (arg.value.c == '\0') {
+                    out.write("\\0", 2);
+                }
+                else if (arg.value.c == '\'') {
+                    out.write("\\'", 2);
+                }
+                else if (esc) {
+                    out.write(esc, 2);
+                }
+                else {
+                    out.put(arg.value.c);
+                }
+                out.put('\'');
+                return true;
+            }
+            else if (spec.type == FormatSpec::Generic || spec.type == FormatSpec::Character || spec.type == FormatSpec::String) {
+                return write_char(out, arg.value.c, spec);
+            }
+            else {
+                long long value = arg.value.c;
+                return write_integer(out, value < 0, value < 0 ? 0ULL - (unsigned long long)value : value, spec);
+            }
+
+        case SafeArg::Int:
+            if (spec.type == FormatSpec::Character) {
+                return write_char(out, (char)arg.value.i, spec);
+            }
+            return write_integer(out, arg.value.i < 0,
+                                 arg.value.i < 0 ? 0ULL - (unsigned long long)arg.value.i : (unsigned long long)arg.value.i,
+                                 spec);
+
+        case SafeArg::UInt:
+            if (spec.type == FormatSpec::Character) {
+                return write_char(out, (char)arg.value.u, spec);
+            }
+            return write_integer(out, false, arg.value.u, spec);
+
+        case SafeArg::Pointer:
+            if (spec.type == FormatSpec::Generic) {
+                FormatSpec hexspec = spec;
+                hexspec.type = FormatSpec::Hex;
+                hexspec.alternate = true;
+                return write_integer(out, false, (unsigned long long)(std::uintptr_t)arg.value.p, hexspec);
+            }
+            else if (spec.type == FormatSpec::Hex) {
+                return write_integer(out, false, (unsigned long long)(std::uintptr_t)arg.value.p, spec);
+            }
+            return false;
+
+        case SafeArg::String:
+            return write_string(out, arg.value.s, conv, spec);
+
+        default:
+            return false;
+        }
+    }
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    // keeps errno unchanged
+    void write_all(int fd, const char* ptr, std::size_t size) noexcept {
+        int saved_errno = errno;
+        while (size > 0) {
+            ssize_t written = ::write(fd, ptr, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            ptr  += written;
+            size -= written;
+        }
+        errno = saved_errno;
+    }
+#endif
+}
+
+std::size_t formatstring::safe_vformat(char* buffer, std::size_t size, const char* fmt,
+                                       const SafeArg* args, std::size_t count) noexcept {
+    Output out(size ? buffer : nullptr, size);
+    std::size_t currentIndex = 0;
+    const char* ptr = fmt;
+
+    while (*ptr) {
+        char ch = *ptr;
+
+        if (ch == '}') {
+            // a lone '}' is kept as it is
+            out.put(ch);
+            ptr += ptr[1] == '}' ? 2 : 1;
+            continue;
+        }
+        else if (ch != '{') {
+            out.put(ch);
+            ++ ptr;
+            continue;
+        }
+        else if (ptr[1] == '{') {
+            out.put(ch);
+            ptr += 2;
+            continue;
+        }
+
+        // parse a replacement field, on errors it is copied instead
+        const char* field = ptr;
+        std::size_t index = currentIndex;
+        Conversion conv = NoConv;
+        FormatSpec spec;
+        bool ok = true;
+
+        ++ ptr;
+        ch = *ptr;
+        if (ch >= '0' && ch <= '9') {
+            index = 0;
+            while (ch >= '0' && ch <= '9') {
+                index = index * 10 + (ch - '0');
+                ch = *++ ptr;
+            }
+        }
+        else {
+            ++ currentIndex;
+        }
+
+        if (ch == '!') {
+            ++ ptr;
+            ch = *ptr;
+            if (ch == 'r') {
+                conv = ReprConv;
+            }
+            else if (ch == 's') {
+                conv = StrConv;
+            }
+            else {
+                ok = false;
+            }
+            if (ch) {
+                ++ ptr;
+            }
+            ch = *ptr;
+        }
+
+        if (ok && ch == ':') {
+            ++ ptr;
+            std::size_t parsed = 0;
+            ok = try_parse_spec(ptr, string_length(ptr), &spec, &parsed) == NoFormatError;
+            ptr += parsed;
+        }
+
+        // find the end of the field to know what to copy on errors
+        while (*ptr && *ptr != '}') {
+            ok = false;
+            ++ ptr;
+        }
+        const char* field_end = *ptr ? ptr + 1 : ptr;
+
+        if (!ok || !*ptr || index >= count || !write_arg(out, args[index], conv, spec)) {
+            out.write(field, field_end - field);
+        }
+        ptr = field_end;
+    }
+
+    return out.finish();
+}
+
+std::size_t formatstring::safe_vformat(char* buffer, std::size_t size, const FormatItems& items,
+                                       const SafeArg* args, std::size_t count) noexcept {
+    Output out(size ? buffer : nullptr, size);
+
+    for (const FormatItem& item : items) {
+        if (item.kind == FormatItem::Literal) {
+            out.write(items.literal(item), item.length);
+        }
+        else if (item.index >= count || !write_arg(out, args[item.index], item.conv, item.spec)) {
+            // the field's text isn't there any more, so only its index is written
+            out.put('{');
+            write_integer(out, false, item.index, FormatSpec());
+            out.put('}');
+        }
+    }
+
+    return out.finish();
+}
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+void formatstring::safe_vprint(int fd, const char* fmt, const SafeArg* args, std::size_t count) noexcept {
+    char buffer[SAFE_PRINT_BUFFER_SIZE];
+    write_all(fd, buffer, safe_vformat(buffer, sizeof(buffer), fmt, args, count));
+}
+
+void formatstring::safe_vprint(int fd, const FormatItems& items, const SafeArg* args, std::size_t count) noexcept {
+    char buffer[SAFE_PRINT_BUFFER_SIZE];
+    write_all(fd, buffer, safe_vformat(buffer, sizeof(buffer), items, args, count));
+}
+#endif
@@ -0,0 +1,90 @@
+#ifndef FORMATSTRING_SCAN_H
+#define FORMATSTRING_SCAN_H
+#pragma once
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define FORMATSTRING_SSE2 1
+#   include <emmintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   endif
+#endif
+
+namespace formatstring {
+    namespace impl {
+
+        // Returns a pointer to the first '{' or '}' in [ptr, end) or end if there is none.
+        template<typename Char>
+        inline const Char* find_brace_scalar(const Char* ptr, const Char* end) {
+            for (; ptr < end; ++ ptr) {
+                Char ch = *ptr;
+                if (ch == '{' || ch == '}') {
+                    break;
+                }
+            }
+            return ptr;
+        }
+
+#ifdef FORMATSTRING_SSE2
+        template<std::size_t Size>
+        struct sse2_lanes;
+
+        template<>
+        struct sse2_lanes<1> {
+            static inline __m128i splat(char ch) { return _mm_set1_epi8(ch); }
+            static inline __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+        };
+
+        template<>
+        struct sse2_lanes<2> {
+            static inline __m128i splat(char ch) { return _mm_set1_epi16(ch); }
+            static inline __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+        };
+
+        template<>
+        struct sse2_lanes<4> {
+            static inline __m128i splat(char ch) { return _mm_set1_epi32(ch); }
+            static inline __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+        };
+
+        inline unsigned int count_trailing_zeros(unsigned int mask) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        // Compares 16 bytes at a time against both braces. The byte mask of
+        // _mm_movemask_epi8 is divided by the character size to get the lane.
+        template<typename Char>
+        inline const Char* find_brace(const Char* ptr, const Char* end) {
+            typedef sse2_lanes<sizeof(Char)> lanes;
+            const std::size_t count = 16 / sizeof(Char);
+            const __m128i open  = lanes::splat('{');
+            const __m128i close = lanes::splat('}');
+
+            for (; (std::size_t)(end - ptr) >= count; ptr += count) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+                int mask = _mm_movemask_epi8(_mm_or_si128(lanes::cmpeq(chunk, open), lanes::cmpeq(chunk, close)));
+                if (mask != 0) {
+                    return ptr + count_trailing_zeros(mask) / sizeof(Char);
+                }
+            }
+
+            return find_brace_scalar(ptr, end);
+        }
+#else
+        template<typename Char>
+        inline const Char* find_brace(const Char* ptr, const Char* end) {
+            return find_brace_scalar(ptr, end);
+        }
+#endif
+    }
+}
+
+#endif // FORMATSTRING_SCAN_H
@@ -0,0 +1,240 @@
+#include "formatstring/scratch.h"
+#include "formatstring/exceptions.h"
+#include "position.h"
+
+#include <ostream>
+#include <streambuf>
+#include <sstream>
+#include <locale>
+#include <vector>
+#include <climits>
+
+using namespace formatstring;
+
+namespace {
+    const std::size_t INITIAL_CAPACITY = 256;
+
+    // larger buffers are freed instead of being kept around by the pool
+    const std::size_t MAX_RETAINED_CAPACITY = 64 * 1024;
+    const std::size_t MAX_POOLED = 16;
+
+    // streambuf that appends to a vector which keeps its capacity between uses
+    template<typename Char>
+    class GrowingBuffer : public std::basic_streambuf<Char> {
+    public:
+        typedef typename std::basic_streambuf<Char>::int_type int_type;
+        typedef typename std::basic_streambuf<Char>::traits_type traits_type;
+        typedef typename std::basic_streambuf<Char>::pos_type pos_type;
+        typedef typename std::basic_streambuf<Char>::off_type off_type;
+
+        GrowingBuffer() : m_data(INITIAL_CAPACITY) {
+            reset();
+        }
+
+        inline void reset() {
+            if (m_data.size() > MAX_RETAINED_CAPACITY) {
+                std::vector<Char>(INITIAL_CAPACITY).swap(m_data);
+            }
+            this->setp(m_data.data(), m_data.data() + m_data.size());
+        }
+
+        inline const Char* data() const { return this->pbase(); }
+        inline std::size_t size() const { return this->pptr() - this->pbase(); }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (traits_type::eq_int_type(ch, traits_type::eof())) {
+                return traits_type::not_eof(ch);
+            }
+
+            grow(m_data.size() * 2);
+
+            *this->pptr() = traits_type::to_char_type(ch);
+            this->pbump(1);
+            return ch;
+        }
+
+        std::streamsize xsputn(const Char* str, std::streamsize count) override {
+            std::size_t used = size();
+            if ((std::size_t)(this->epptr() - this->pptr()) < (std::size_t)count) {
+                std::size_t capacity = m_data.size() * 2;
+                while (capacity - used < (std::size_t)count) {
+                    capacity *= 2;
+                }
+                grow(capacity);
+            }
+
+            traits_type::copy(this->pptr(), str, count);
+            advance((std::size_t)count);
+            return count;
+        }
+
+        // only reports the position, so tellp() works on scratch streams
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out)) {
+                return pos_type(off_type(size()));
+            }
+            return pos_type(off_type(-1));
+        }
+
+    private:
+        void grow(std::size_t capacity) {
+            std::size_t used = size();
+            m_data.resize(capacity);
+            this->setp(m_data.data(), m_data.data() + m_data.size());
+            advance(used);
+        }
+
+        // pbump() takes an int, so larger offsets are applied in steps
+        inline void advance(std::size_t count) {
+            while (count > (std::size_t)INT_MAX) {
+                this->pbump(INT_MAX);
+                count -= INT_MAX;
+            }
+            this->pbump((int)count);
+        }
+
+        std::vector<Char> m_data;
+    };
+
+    template<typename Char>
+    struct Scratch {
+        GrowingBuffer<Char>      buffer;
+        std::basic_ostream<Char> stream;
+        std::locale              locale; // the one imbued into stream
+
+        Scratch() : buffer(), stream(&buffer), locale(stream.getloc()) {}
+
+        void reset() {
+            buffer.reset();
+            stream.exceptions(std::ios_base::goodbit);
+            stream.clear();
+            stream.flags(std::ios_base::skipws | std::ios_base::dec);
+            stream.precision(6);
+            stream.width(0);
+            stream.fill(stream.widen(' '));
+        }
+    };
+
+    template<typename Char>
+    struct Pool {
+        std::vector<Scratch<Char>*> free;
+
+        ~Pool();
+    };
+
+    // Trivial thread locals stay usable while the thread is torn down, so
+    // this tells whether the pool itself is still there.
+    template<typename Char>
+    struct PoolState {
+        static thread_local bool destroyed;
+    };
+
+    template<typename Char>
+    thread_local bool PoolState<Char>::destroyed = false;
+
+    template<typename Char>
+    Pool<Char>::~Pool() {
+        PoolState<Char>::destroyed = true;
+        for (Scratch<Char>* scratch : free) {
+            delete scratch;
+        }
+    }
+
+    template<typename Char>
+    inline Pool<Char>* thread_pool() {
+        if (PoolState<Char>::destroyed) {
+            return nullptr;
+        }
+        static thread_local Pool<Char> pool;
+        return &pool;
+    }
+}
+
+template<typename Char>
+BasicScratchBuffer<Char>::BasicScratchBuffer() : m_impl(nullptr) {
+    acquire(std::locale());
+}
+
+template<typename Char>
+BasicScratchBuffer<Char>::BasicScratchBuffer(const std::locale& locale) : m_impl(nullptr) {
+    acquire(locale);
+}
+
+template<typename Char>
+void BasicScratchBuffer<Char>::acquire(const std::locale& locale) {
+    Scratch<Char>* scratch;
+    Pool<Char>* pool = thread_pool<Char>();
+    if (pool && !pool->free.empty()) {
+        scratch = pool->free.back();
+        pool->free.pop_back();
+    }
+    else {
+        scratch = new Scratch<Char>();
+    }
+    m_impl = scratch;
+
+    if (!(scratch->locale == locale)) {
+        scratch->stream.imbue(locale);
+        scratch->locale = locale;
+    }
+}
+
+template<typename Char>
+BasicScratchBuffer<Char>::~BasicScratchBuffer() {
+    Scratch<Char>* scratch = static_cast<Scratch<Char>*>(m_impl);
+    Pool<Char>* pool = thread_pool<Char>();
+
+    if (pool && pool->free.size() < MAX_POOLED) {
+        FORMATSTRING_TRY {
+            scratch->reset();
+            pool->free.push_back(scratch);
+            return;
+        }
+        FORMATSTRING_CATCH_ALL {}
+    }
+
+    delete scratch;
+}
+
+template<typename Char>
+std::basic_ostream<Char>& BasicScratchBuffer<Char>::stream() noexcept {
+    return static_cast<Scratch<Char>*>(m_impl)->stream;
+}
+
+template<typename Char>
+const Char* BasicScratchBuffer<Char>::data() const noexcept {
+    return static_cast<const Scratch<Char>*>(m_impl)->buffer.data();
+}
+
+template<typename Char>
+std::size_t BasicScratchBuffer<Char>::size() const noexcept {
+    return static_cast<const Scratch<Char>*>(m_impl)->buffer.size();
+}
+
+template<typename Char>
+std::int64_t formatstring::impl::memory_position(std::basic_ostream<Char>& out) {
+    std::basic_streambuf<Char>* buffer = out.rdbuf();
+    if (GrowingBuffer<Char>* growing = dynamic_cast<GrowingBuffer<Char>*>(buffer)) {
+        return (std::int64_t)growing->size();
+    }
+    if (dynamic_cast<std::basic_stringbuf<Char>*>(buffer)) {
+        return (std::int64_t)buffer->pubseekoff(0, std::ios_base::cur, std::ios_base::out);
+    }
+    return -1;
+}
+
+template class BasicScratchBuffer<char>;
+template class BasicScratchBuffer<wchar_t>;
+template std::int64_t impl::memory_position<char>(std::ostream& out);
+template std::int64_t impl::memory_position<wchar_t>(std::wostream& out);
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicScratchBuffer<char16_t>;
+template std::int64_t impl::memory_position<char16_t>(std::basic_ostream<char16_t>& out);
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicScratchBuffer<char32_t>;
+template std::int64_t impl::memory_position<char32_t>(std::basic_ostream<char32_t>& out);
+#endif
@@ -0,0 +1,59 @@
+#include "formatstring/sharedwriter.h"
+
+#include <ostream>
+#include <system_error>
+#include <cerrno>
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+#   include <unistd.h>
+#endif
+
+using namespace formatstring;
+
+template<typename Char>
+BasicSharedWriter<Char>::BasicSharedWriter(std::basic_ostream<Char>& out) : m_out(&out), m_fd(-1) {}
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+template<typename Char>
+BasicSharedWriter<Char>::BasicSharedWriter(int fd) : m_out(nullptr), m_fd(fd) {}
+#endif
+
+template<typename Char>
+void BasicSharedWriter<Char>::commit(const Char* data, std::size_t size) {
+    if (m_out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_out->write(data, size);
+        return;
+    }
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    // Usually a single write(2) per record, but pipes split records over
+    // PIPE_BUF bytes, sockets may take less and signals interrupt, so the
+    // rest is written under the same lock as the first part.
+    const char* bytes = reinterpret_cast<const char*>(data);
+    std::size_t remaining = size * sizeof(Char);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (remaining > 0) {
+        ssize_t count = ::write(m_fd, bytes, remaining);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FORMATSTRING_THROW(std::system_error(errno, std::generic_category(), "write"));
+        }
+        bytes += count;
+        remaining -= count;
+    }
+#endif
+}
+
+template class BasicSharedWriter<char>;
+template class BasicSharedWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicSharedWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicSharedWriter<char32_t>;
+#endif
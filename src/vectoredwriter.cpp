@@ -0,0 +1,167 @@
+#include "formatstring/vectoredwriter.h"
+#include "formatstring/scratch.h"
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+
+#include <ostream>
+#include <algorithm>
+#include <system_error>
+#include <climits>
+#include <cerrno>
+
+#include <unistd.h>
+
+using namespace formatstring;
+
+#ifdef IOV_MAX
+static const std::size_t MAX_SEGMENTS = IOV_MAX;
+#else
+static const std::size_t MAX_SEGMENTS = 1024;
+#endif
+
+template<typename Char>
+const std::size_t BasicVectoredWriter<Char>::MIN_REFERENCED_LITERAL;
+
+template<typename Char>
+BasicVectoredWriter<Char>::BasicVectoredWriter(int fd, std::size_t buffer_size) :
+        m_fd(fd), m_buffer_size(buffer_size), m_max_segments(MAX_SEGMENTS) {
+    long max_segments = sysconf(_SC_IOV_MAX);
+    if (max_segments > 0) {
+        m_max_segments = (std::size_t)max_segments;
+    }
+}
+
+template<typename Char>
+BasicVectoredWriter<Char>::~BasicVectoredWriter() {
+    FORMATSTRING_TRY {
+        flush();
+    }
+    FORMATSTRING_CATCH_ALL {}
+}
+
+template<typename Char>
+void BasicVectoredWriter<Char>::append(const BasicFormatItems<Char>& items, const BasicFormatters<Char>& formatters) {
+    typedef BasicFormatItem<Char> Item;
+
+    // values are rendered into a scratch buffer first, so a record that
+    // fails half way leaves no trace
+    BasicScratchBuffer<Char> buffer;
+    std::basic_ostream<Char>& out = buffer.stream();
+    std::size_t first = m_segments.size();
+    std::size_t base  = m_values.size();
+
+    FORMATSTRING_TRY {
+        for (const Item& item : items) {
+            if (item.kind == Item::Literal && item.length >= MIN_REFERENCED_LITERAL) {
+                Segment segment = {items.literal(item), 0, item.length};
+                m_segments.push_back(segment);
+                continue;
+            }
+
+            std::size_t start = buffer.size();
+            if (item.kind == Item::Literal) {
+                out.write(items.literal(item), item.length);
+            }
+            else {
+                if (item.index >= formatters.size()) {
+                    FORMATSTRING_THROW(InvalidFormatArgumentException(item.index));
+                }
+                formatters[item.index](out, item.conv, item.spec);
+            }
+
+            std::size_t length = buffer.size() - start;
+            if (length == 0) {
+                continue;
+            }
+
+            // extend the previous segment if it's the text right before this one
+            if (m_segments.size() > first && !m_segments.back().literal &&
+                    m_segments.back().offset + m_segments.back().length == base + start) {
+                m_segments.back().length += length;
+            }
+            else {
+                Segment segment = {nullptr, base + start, length};
+                m_segments.push_back(segment);
+            }
+        }
+
+        m_values.insert(m_values.end(), buffer.data(), buffer.data() + buffer.size());
+    }
+    FORMATSTRING_CATCH_ALL {
+        m_segments.resize(first);
+        FORMATSTRING_RETHROW;
+    }
+
+    if (m_segments.size() >= m_max_segments || m_values.size() >= m_buffer_size) {
+        flush();
+    }
+}
+
+template<typename Char>
+std::size_t BasicVectoredWriter<Char>::size() const noexcept {
+    std::size_t size = 0;
+    for (const Segment& segment : m_segments) {
+        size += segment.length;
+    }
+    return size;
+}
+
+template<typename Char>
+void BasicVectoredWriter<Char>::flush() {
+    std::size_t pos = 0;
+
+    while (pos < m_segments.size()) {
+        std::size_t count = std::min(m_segments.size() - pos, m_max_segments);
+        m_iov.resize(count);
+        for (std::size_t i = 0; i < count; ++ i) {
+            const Segment& segment = m_segments[pos + i];
+            const Char* data = segment.literal ? segment.literal : m_values.data() + segment.offset;
+            m_iov[i].iov_base = const_cast<Char*>(data);
+            m_iov[i].iov_len  = segment.length * sizeof(Char);
+        }
+
+        iovec* iov = m_iov.data();
+        while (count > 0) {
+            ssize_t written = ::writev(m_fd, iov, (int)count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                m_segments.clear();
+                m_values.clear();
+                FORMATSTRING_THROW(std::system_error(error, std::generic_category(), "writev"));
+            }
+
+            // skip what was written, a short write can end within a segment
+            std::size_t remaining = (std::size_t)written;
+            while (count > 0 && remaining >= iov->iov_len) {
+                remaining -= iov->iov_len;
+                ++ iov;
+                -- count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+                iov->iov_len -= remaining;
+            }
+        }
+
+        pos += m_iov.size();
+    }
+
+    m_segments.clear();
+    m_values.clear();
+}
+
+template class BasicVectoredWriter<char>;
+template class BasicVectoredWriter<wchar_t>;
+
+#ifdef FORMATSTRING_CHAR16_SUPPORT
+template class BasicVectoredWriter<char16_t>;
+#endif
+
+#ifdef FORMATSTRING_CHAR32_SUPPORT
+template class BasicVectoredWriter<char32_t>;
+#endif
+
+#endif // FORMATSTRING_POSIX_IO_SUPPORT
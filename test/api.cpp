@@ -0,0 +1,1272 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <streambuf>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <tuple>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+
+#include <formatstring.h>
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+#   include <unistd.h>
+#   include <signal.h>
+#   include <sys/time.h>
+#endif
+
+#include "check.h"
+
+using namespace formatstring;
+
+// Checks of the C++ API that can't be driven through the format binary.
+// Every test prints one line in the style of test.py, the exit status is
+// the number of failed tests.
+
+// ---- arena (BasicFormatItems) ----
+
+static void test_format_copy() {
+    Format copy = compile("x={} y={}");
+    {
+        Format original = compile("a={} b={}");
+        Format shared(original);
+        CHECK(shared.items().begin() == original.items().begin());
+        CHECK(shared.items().literals() == original.items().literals());
+
+        copy = original;
+        CHECK(copy.items().begin() == original.items().begin());
+    }
+    // the last handle keeps the block alive
+    CHECK_EQUAL(std::string("a=1 b=2"), copy(1, 2).str());
+
+    const Format& self = copy;
+    copy = self;
+    CHECK_EQUAL(std::string("a=3 b=4"), copy(3, 4).str());
+}
+
+static void test_format_move() {
+    Format original = compile("a={} b={}");
+    const FormatItem* items = original.items().begin();
+
+    Format moved(std::move(original));
+    CHECK(moved.items().begin() == items);
+    CHECK(original.items().empty());
+    CHECK(original.items().begin() == nullptr);
+
+    Format assigned = compile("{}");
+    assigned = std::move(moved);
+    CHECK(assigned.items().begin() == items);
+    CHECK(moved.items().empty());
+    CHECK_EQUAL(std::string("a=1 b=2"), assigned(1, 2).str());
+
+    // moved from handles can be assigned again
+    moved = assigned;
+    CHECK_EQUAL(std::string("a=3 b=4"), moved(3, 4).str());
+}
+
+static void test_items_view() {
+    Format owner = compile("<{}>");
+    FormatItems view = owner.items().view();
+    CHECK(view.begin() == owner.items().begin());
+    CHECK(view.literals() == owner.items().literals());
+
+    // copies of a view are views as well, they don't keep the block alive
+    FormatItems copy(view);
+    CHECK(copy.begin() == view.begin());
+
+    Format viewed(copy);
+    CHECK_EQUAL(std::string("<x>"), viewed("x").str());
+}
+
+static void test_ref_outlives_handle() {
+    Format keep = compile("{}");
+    FormatRef ref = keep.ref();
+    {
+        Format temporary = compile("[{}|{}]");
+        keep = temporary;
+        ref  = temporary.ref();
+    }
+    // the items referred to are kept alive by keep, not by the gone handle
+    CHECK(ref.items().begin() == keep.items().begin());
+    CHECK_EQUAL(std::string("[a|1]"), ref(std::string("a"), 1).str());
+
+    std::ostringstream out;
+    ref.format(out, "b", 2);
+    CHECK_EQUAL(std::string("[b|2]"), out.str());
+}
+
+static void test_literal_merging() {
+    Format fmt = compile("a{{b}}c{}d");
+    const FormatItems& items = fmt.items();
+    CHECK_EQUAL((std::size_t)3, items.size());
+    CHECK(items[0].kind == FormatItem::Literal);
+    CHECK_EQUAL(std::string("a{b}c"), std::string(items.literal(items[0]), items[0].length));
+    CHECK(items[1].kind == FormatItem::Value);
+    CHECK(items[2].kind == FormatItem::Literal);
+    CHECK_EQUAL(std::string("d"), std::string(items.literal(items[2]), items[2].length));
+
+    CHECK_EQUAL((std::size_t)2, compile("{}{}").items().size());
+    CHECK_EQUAL((std::size_t)1, compile("{{}}").items().size());
+    CHECK_EQUAL((std::size_t)0, compile("").items().size());
+}
+
+// ---- owned records ----
+
+static void test_owned_outlives_arguments() {
+    Format fmt = compile("{} {} {} {}");
+    OwnedFormat owned;
+    {
+        std::string str = "string";
+        std::vector<int> vec = {1, 2, 3};
+        char buf[] = "buffer";
+        owned = fmt.bind_owned(str, vec, buf, 42);
+        str = "changed";
+        vec.clear();
+        buf[0] = 'B';
+    }
+    CHECK_EQUAL((std::size_t)4, owned.argc());
+    CHECK_EQUAL(std::string("string [1, 2, 3] buffer 42"), owned.str());
+
+    // the record is moved, not copied
+    OwnedFormat moved(std::move(owned));
+    CHECK_EQUAL((std::size_t)0, owned.argc());
+    CHECK_EQUAL(std::string(""), owned.str());
+    CHECK_EQUAL(std::string("string [1, 2, 3] buffer 42"), moved.str());
+
+    std::ostringstream out;
+    out << moved;
+    CHECK_EQUAL(std::string("string [1, 2, 3] buffer 42"), out.str());
+}
+
+static void test_owned_outlives_format() {
+    OwnedFormat copied;
+    {
+        Format fmt = compile("<{}>");
+        copied = fmt.bind_owned(std::string("copied"));
+    }
+    // bind_owned() on a format keeps the items alive
+    CHECK_EQUAL(std::string("<copied>"), copied.str());
+
+    Format fmt = compile("[{}]");
+    OwnedFormat referred = fmt.ref().bind_owned("referred");
+    CHECK(referred.format().items().begin() == fmt.items().begin());
+    CHECK_EQUAL(std::string("[referred]"), referred.str());
+}
+
+static void test_owned_strings() {
+    const std::string nul("a\0b", 3);
+    Format fmt = compile("{}|{!r}|{!s}|{: >6}|{!r: <10}|");
+    std::string expected = fmt(nul, nul, nul, nul, nul).str();
+    const char chars[] = "a\0b|\"a\\0b\"|a\0b|   a\0b|\"a\\0b\"    |";
+    CHECK_EQUAL(std::string(chars, sizeof(chars) - 1), expected);
+    CHECK_EQUAL(expected, fmt.bind_owned(nul, nul, nul, nul, nul).str());
+
+    const char* cstr = "x??y";
+    CHECK_EQUAL(format("{!r} {!r}", cstr, std::string(cstr)).str(),
+                compile("{!r} {!r}").bind_owned(cstr, std::string(cstr)).str());
+
+    WFormat wfmt = compile(L"{}|{!r}");
+    const std::wstring wnul(L"w\0", 2);
+    CHECK(wfmt(wnul, wnul).str() == wfmt.bind_owned(wnul, wnul).str());
+    const wchar_t wchars[] = L"w\0|L\"w\\0\"";
+    CHECK(std::wstring(wchars, sizeof(wchars) / sizeof(wchar_t) - 1) == wfmt.bind_owned(wnul, wnul).str());
+}
+
+static void test_owned_assign() {
+    Format fmt = compile("{}-{}");
+    OwnedFormat first  = fmt.bind_owned(std::string("a"), 1);
+    OwnedFormat second = fmt.bind_owned(std::string("b"), 2);
+
+    first = std::move(second);
+    CHECK_EQUAL(std::string("b-2"), first.str());
+    CHECK_EQUAL((std::size_t)0, second.size());
+
+    OwnedFormat& self = first;
+    first = std::move(self);
+    CHECK_EQUAL(std::string("b-2"), first.str());
+
+    second = fmt.bind_owned(std::string("c"), 3);
+    CHECK_EQUAL(std::string("c-3"), second.str());
+}
+
+// ---- async writer ----
+
+// Holds up the first write until it is opened, so the writer thread can
+// be stalled while the queue is filled.
+class GateBuffer : public std::streambuf {
+public:
+    GateBuffer() : m_entered(false), m_open(false) {}
+
+    void wait_entered() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return m_entered; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_cond.notify_all();
+    }
+
+    std::string str() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_data;
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            char chr = traits_type::to_char_type(ch);
+            xsputn(&chr, 1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char* str, std::streamsize count) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entered = true;
+        m_cond.notify_all();
+        m_cond.wait(lock, [this] { return m_open; });
+        m_data.append(str, count);
+        return count;
+    }
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    bool                    m_entered;
+    bool                    m_open;
+    std::string             m_data;
+};
+
+// opens the gate when a check fails, so the writer thread can be stopped
+class OpenOnExit {
+public:
+    OpenOnExit(GateBuffer& gate) : m_gate(gate) {}
+    ~OpenOnExit() { m_gate.open(); }
+
+private:
+    GateBuffer& m_gate;
+};
+
+// Stalls the writer thread on record 0 and fills the queue with records
+// 1 to 4, so that pushing record 5 overflows. Returns what push() returned.
+static bool overflow_queue(AsyncWriter& writer, GateBuffer& gate, const Format& fmt) {
+    CHECK(writer.write(fmt, 0));
+    gate.wait_entered();
+    for (int i = 1; i <= (int)writer.capacity(); ++ i) {
+        CHECK(writer.write(fmt, i));
+    }
+    CHECK_EQUAL(writer.capacity(), writer.stats().depth);
+    return writer.write(fmt, (int)writer.capacity() + 1);
+}
+
+static void test_async_drop() {
+    Format fmt = compile("{}\n");
+    GateBuffer gate;
+    std::ostream out(&gate);
+    AsyncWriter writer(out, 4, DropOnOverflow);
+    OpenOnExit guard(gate);
+
+    CHECK(!overflow_queue(writer, gate, fmt));
+    CHECK_EQUAL((std::uint64_t)1, writer.stats().dropped);
+
+    gate.open();
+    writer.flush();
+    CHECK_EQUAL(std::string("0\n1\n2\n3\n4\n"), gate.str());
+    CHECK_EQUAL((std::uint64_t)5, writer.stats().written);
+}
+
+static void test_async_drop_oldest() {
+    Format fmt = compile("{}\n");
+    GateBuffer gate;
+    std::ostream out(&gate);
+    AsyncWriter writer(out, 4, DropOldestOnOverflow);
+    OpenOnExit guard(gate);
+
+    CHECK(overflow_queue(writer, gate, fmt));
+    CHECK_EQUAL((std::uint64_t)1, writer.stats().dropped);
+
+    gate.open();
+    writer.flush();
+    CHECK_EQUAL(std::string("0\n2\n3\n4\n5\n"), gate.str());
+    CHECK_EQUAL((std::uint64_t)5, writer.stats().written);
+}
+
+static void test_async_block() {
+    Format fmt = compile("{}\n");
+    GateBuffer gate;
+    std::ostream out(&gate);
+    AsyncWriter writer(out, 4, BlockOnOverflow);
+    OpenOnExit guard(gate);
+
+    std::atomic<bool> pushed(false);
+    std::string error;
+    std::thread producer([&] {
+        try {
+            overflow_queue(writer, gate, fmt);
+        }
+        catch (const std::exception& exc) {
+            error = exc.what();
+        }
+        pushed.store(true);
+    });
+
+    // the last push waits for the stalled writer thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bool early = pushed.load();
+    gate.open();
+    producer.join();
+    if (!error.empty()) {
+        throw TestFailure(error);
+    }
+    CHECK(!early);
+
+    writer.flush();
+    CHECK_EQUAL(std::string("0\n1\n2\n3\n4\n5\n"), gate.str());
+    CHECK_EQUAL((std::uint64_t)0, writer.stats().dropped);
+    CHECK_EQUAL((std::uint64_t)6, writer.stats().written);
+}
+
+// ---- shared writer ----
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+// A pipe whose read end is drained by a thread, so writes over PIPE_BUF
+// bytes may be split. A slow reader keeps the pipe full, so writers block
+// and signals can interrupt them part way. SIGALRM is left to the other
+// threads.
+class PipeReader {
+public:
+    explicit PipeReader(bool slow = false) : m_fds{-1, -1} {
+        if (::pipe(m_fds) != 0) {
+            throw TestFailure("pipe() failed");
+        }
+        m_thread = std::thread([this, slow] {
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGALRM);
+            pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+            char buffer[4096];
+            const std::size_t chunk = slow ? 256 : sizeof(buffer);
+            ssize_t count;
+            while ((count = ::read(m_fds[0], buffer, chunk)) != 0) {
+                if (count > 0) {
+                    m_data.append(buffer, (std::size_t)count);
+                    if (slow) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(20));
+                    }
+                }
+                else if (errno != EINTR) {
+                    break;
+                }
+            }
+        });
+    }
+
+    ~PipeReader() {
+        close();
+        ::close(m_fds[0]);
+    }
+
+    inline int fd() const { return m_fds[1]; }
+
+    // closes the write end and returns everything written to it
+    const std::string& data() {
+        close();
+        return m_data;
+    }
+
+private:
+    void close() {
+        if (m_fds[1] >= 0) {
+            ::close(m_fds[1]);
+            m_fds[1] = -1;
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    int         m_fds[2];
+    std::thread m_thread;
+    std::string m_data;
+};
+#endif
+
+static const std::size_t SHARED_THREADS = 4;
+static const std::size_t SHARED_RECORDS = 64;
+
+// every fourth record is larger than a pipe's buffer
+static std::string shared_payload(std::size_t thread, std::size_t record) {
+    return std::string(record % 4 == 0 ? 100000 : 10 + record, (char)('a' + (thread * 7 + record) % 26));
+}
+
+static void write_shared_records(SharedWriter& writer) {
+    Format fmt = compile("{}:{}:{}\n");
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 0; thread < SHARED_THREADS; ++ thread) {
+        threads.emplace_back([&writer, &fmt, thread] {
+            for (std::size_t record = 0; record < SHARED_RECORDS; ++ record) {
+                writer.write(fmt, thread, record, shared_payload(thread, record));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// every record must come out whole and in order per thread
+static void check_shared_records(const std::string& data) {
+    std::vector<std::size_t> next(SHARED_THREADS, 0);
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        std::size_t end = data.find('\n', pos);
+        CHECK(end != std::string::npos);
+        const std::string line = data.substr(pos, end - pos);
+        pos = end + 1;
+
+        std::size_t first  = line.find(':');
+        std::size_t second = line.find(':', first + 1);
+        CHECK(second != std::string::npos);
+        std::size_t thread = std::stoul(line.substr(0, first));
+        std::size_t record = std::stoul(line.substr(first + 1, second - first - 1));
+        CHECK(thread < SHARED_THREADS);
+        CHECK_EQUAL(next[thread], record);
+        CHECK(line.compare(second + 1, std::string::npos, shared_payload(thread, record)) == 0);
+        ++ next[thread];
+    }
+    for (std::size_t count : next) {
+        CHECK_EQUAL(SHARED_RECORDS, count);
+    }
+}
+
+static void test_shared_stream() {
+    std::ostringstream out;
+    SharedWriter writer(out);
+    write_shared_records(writer);
+    check_shared_records(out.str());
+}
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+static void test_shared_fd() {
+    PipeReader pipe;
+    SharedWriter writer(pipe.fd());
+    write_shared_records(writer);
+    check_shared_records(pipe.data());
+}
+#endif
+
+// ---- scratch buffers ----
+
+static void test_scratch_growth() {
+    // single characters, short and long writes across many reallocations
+    std::string expected;
+    ScratchBuffer buffer;
+    for (std::size_t i = 0; i < 20; ++ i) {
+        const std::string chunk((std::size_t)1 << i, (char)('a' + i));
+        buffer.stream() << (char)('A' + i);
+        buffer.stream().write(chunk.data(), (std::streamsize)chunk.size());
+        expected += (char)('A' + i);
+        expected += chunk;
+        CHECK_EQUAL(expected.size(), buffer.size());
+        CHECK_EQUAL((std::streamoff)expected.size(), (std::streamoff)buffer.stream().tellp());
+    }
+    CHECK(buffer.str() == expected);
+}
+
+// ---- batch format ----
+
+static std::string sequential_batch(const Format& fmt, const std::vector< std::tuple<int,std::string,double> >& records) {
+    std::string text;
+    for (const auto& record : records) {
+        text += fmt(std::get<0>(record), std::get<1>(record), std::get<2>(record)).str();
+    }
+    return text;
+}
+
+static void test_batch_order() {
+    const Format fmt = compile("{: >6} {!r} {:.2f}\n");
+    std::vector< std::tuple<int,std::string,double> > records;
+    for (int i = 0; i < 20000; ++ i) {
+        records.emplace_back(i, std::string((std::size_t)(i % 13), (char)('a' + i % 26)), i * 0.25);
+    }
+
+    // fewer records than one chunk, several chunks per thread and more
+    // chunks than buffered slots
+    const std::size_t counts[] = {0, 1, 63, 64, 1000, 20000};
+    const unsigned int threads[] = {1, 2, 3, 8, 0};
+    for (std::size_t count : counts) {
+        std::vector< std::tuple<int,std::string,double> > part(records.begin(), records.begin() + count);
+        const std::string expected = sequential_batch(fmt, part);
+        for (unsigned int thread_count : threads) {
+            std::ostringstream out;
+            fmt.format_batch(part, out, thread_count);
+            CHECK_EQUAL(expected, out.str());
+        }
+    }
+}
+
+// throws when formatted if its value is negative
+struct Bomb {
+    int value;
+};
+
+static std::ostream& operator<< (std::ostream& out, const Bomb& bomb) {
+    if (bomb.value < 0) {
+        throw std::runtime_error("bomb");
+    }
+    return out << bomb.value;
+}
+
+static void test_batch_error() {
+    const Format fmt = compile("{} {}\n");
+    const std::size_t count = 20000;
+    const std::size_t failing[] = {0, 1, 10000, count - 1};
+    const unsigned int threads[] = {1, 4};
+
+    for (std::size_t bad : failing) {
+        std::vector< std::tuple<int,Bomb> > records;
+        std::string expected;
+        for (std::size_t i = 0; i < count; ++ i) {
+            records.emplace_back((int)i, Bomb{i == bad ? -1 : (int)i});
+            if (i < bad) {
+                expected += fmt((int)i, (int)i).str();
+            }
+        }
+
+        for (unsigned int thread_count : threads) {
+            std::ostringstream out;
+            out << "> ";
+            CHECK_THROWS(std::runtime_error, fmt.format_batch(records, out, thread_count));
+
+            // whole chunks before the failing record and nothing of its chunk
+            const std::string text = out.str().substr(2);
+            CHECK(text.size() <= expected.size());
+            CHECK(expected.compare(0, text.size(), text) == 0);
+            CHECK(text.empty() || text[text.size() - 1] == '\n');
+            if (bad == 0) {
+                CHECK_EQUAL(std::string(), text);
+            }
+        }
+    }
+}
+
+// ---- print ----
+
+// a tmpfile() that is closed on destruction
+class TempFile {
+public:
+    TempFile() : m_file(std::tmpfile()) {
+        if (!m_file) {
+            throw TestFailure("tmpfile() failed");
+        }
+    }
+
+    ~TempFile() { std::fclose(m_file); }
+
+    inline std::FILE* file() const { return m_file; }
+
+    std::string data() const {
+        std::string data;
+        char buffer[4096];
+        std::size_t count;
+        std::fflush(m_file);
+        std::rewind(m_file);
+        while ((count = std::fread(buffer, 1, sizeof(buffer), m_file)) > 0) {
+            data.append(buffer, count);
+        }
+        return data;
+    }
+
+private:
+    std::FILE* m_file;
+};
+
+static void test_print_file() {
+    TempFile file;
+    const Format fmt = compile("{} + {} = {}");
+    print(file.file(), fmt, 1, 2, 3);
+    println(file.file(), fmt.ref(), 4, 5, 9);
+    println(file.file(), "{!r}", "x");
+    print(file.file(), std::string("{:.1f}|"), 0.25);
+    CHECK_THROWS(std::runtime_error, println(file.file(), "{} {}", 1, Bomb{-1}));
+    CHECK_EQUAL(std::string("1 + 2 = 34 + 5 = 9\n\"x\"\n0.2|"), file.data());
+
+    // wide characters go out as they are
+    TempFile wide_file;
+    println(wide_file.file(), L"{} {}", 1, L"\u00e4");
+    const std::string bytes = wide_file.data();
+    std::wstring wide(bytes.size() / sizeof(wchar_t), L'\0');
+    std::memcpy(&wide[0], bytes.data(), wide.size() * sizeof(wchar_t));
+    CHECK(wide == L"1 \u00e4\n");
+}
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+static void test_print_fd() {
+    PipeReader pipe;
+    const Format fmt = compile("{: >3}|");
+    print(pipe.fd(), fmt, 7);
+    println(pipe.fd(), fmt, 42);
+    println(pipe.fd(), std::string("{} {}"), "a", 'b');
+    CHECK_THROWS(std::runtime_error, print(pipe.fd(), "{}{}", "lost", Bomb{-1}));
+
+    // larger than PIPE_BUF, written in one piece
+    const std::string large(100000, 'z');
+    println(pipe.fd(), "<{}>", large);
+    CHECK_EQUAL("  7| 42|\na b\n<" + large + ">\n", pipe.data());
+}
+#endif
+
+// ---- vectored writer ----
+
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+static void test_vectored_segments() {
+    const std::string short_literal(VectoredWriter::MIN_REFERENCED_LITERAL - 1, '-');
+    const std::string long_literal(VectoredWriter::MIN_REFERENCED_LITERAL, '=');
+    PipeReader pipe;
+    std::string expected;
+    {
+        VectoredWriter writer(pipe.fd());
+
+        // short literals and values are merged into one segment
+        const Format merged = compile("a {}" + short_literal + "{}\n");
+        writer.write(merged, 1, "x");
+        CHECK_EQUAL(std::size_t(1), writer.segments());
+        expected += merged(1, "x").str();
+
+        // records start a new segment
+        writer.write(merged, 2, "y");
+        CHECK_EQUAL(std::size_t(2), writer.segments());
+        expected += merged(2, "y").str();
+
+        // literals of MIN_REFERENCED_LITERAL characters are referenced
+        const Format referenced = compile("{}" + long_literal + "{}\n");
+        writer.write(referenced, 3, 4);
+        CHECK_EQUAL(std::size_t(5), writer.segments());
+        expected += referenced(3, 4).str();
+        CHECK_EQUAL(expected.size(), writer.size());
+
+        // a formatter that throws part way leaves nothing of its record
+        const Format failing = compile("{}" + long_literal + "{}" + long_literal + "{}\n");
+        CHECK_THROWS(std::runtime_error, writer.write(failing, 5, Bomb{-1}, 6));
+        CHECK_EQUAL(std::size_t(5), writer.segments());
+        CHECK_EQUAL(expected.size(), writer.size());
+
+        writer.write(failing, 7, Bomb{8}, 9);
+        expected += failing(7, Bomb{8}, 9).str();
+        CHECK_EQUAL(std::size_t(10), writer.segments());
+        writer.flush();
+        CHECK_EQUAL(std::size_t(0), writer.segments());
+    }
+    CHECK_EQUAL(expected, pipe.data());
+}
+
+static volatile sig_atomic_t vectored_alarms = 0;
+
+static void count_alarm(int) {
+    ++ vectored_alarms;
+}
+
+// interrupts the calling thread every 100 microseconds, without SA_RESTART
+// a blocked writev() returns what it wrote so far
+class AlarmTimer {
+public:
+    AlarmTimer() {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = count_alarm;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGALRM, &action, &m_action);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec  = 0;
+        timer.it_interval.tv_usec = 100;
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_REAL, &timer, nullptr);
+    }
+
+    ~AlarmTimer() {
+        struct itimerval timer;
+        std::memset(&timer, 0, sizeof(timer));
+        setitimer(ITIMER_REAL, &timer, nullptr);
+        sigaction(SIGALRM, &m_action, nullptr);
+    }
+
+private:
+    struct sigaction m_action;
+};
+
+static void test_vectored_partial() {
+    // every record has 2 * 20 + 1 segments, so a flush holds more than
+    // one writev() batch, and each flush is larger than the pipe's buffer
+    std::string fmt;
+    for (int i = 0; i < 20; ++ i) {
+        fmt += "{}";
+        fmt += std::string(200 + i, (char)('a' + i));
+    }
+    fmt += "{}\n";
+    const Format format = compile(fmt);
+
+    PipeReader pipe(true);
+    std::string expected;
+    {
+        VectoredWriter writer(pipe.fd(), 1024 * 1024);
+        AlarmTimer alarms;
+        for (int record = 0; record < 400; ++ record) {
+            const int a = record, b = record * 3, c = -record;
+            writer.write(format, a, b, c, a, b, c, a, b, c, a, b, c, a, b, c, a, b, c, a, b, c);
+            expected += format(a, b, c, a, b, c, a, b, c, a, b, c, a, b, c, a, b, c, a, b, c).str();
+        }
+        writer.flush();
+    }
+    const std::string& data = pipe.data();
+    CHECK_EQUAL(expected.size(), data.size());
+    CHECK(expected == data);
+    CHECK(vectored_alarms > 0);
+}
+#endif
+
+// ---- catalog ----
+
+// a valid binary catalog in memory that is aligned for its items
+static std::vector<std::uint64_t> catalog_storage(std::size_t* size) {
+    CatalogWriter writer;
+    writer.add("greeting", "hello {}");
+    writer.add("sum", "{} + {} = {}");
+    std::ostringstream out;
+    writer.write(out);
+
+    std::string data = out.str();
+    std::vector<std::uint64_t> storage(data.size() / sizeof(std::uint64_t) + 1);
+    std::memcpy(storage.data(), data.data(), data.size());
+    *size = data.size();
+    return storage;
+}
+
+static void test_catalog_bounds() {
+    std::size_t size = 0;
+    std::vector<std::uint64_t> storage = catalog_storage(&size);
+    {
+        CatalogFile file(storage.data(), size);
+        CHECK_EQUAL(std::string("hello x"), file.at("greeting")("x").str());
+    }
+
+    catalog::Header header;
+    std::memcpy(&header, storage.data(), sizeof(header));
+
+    // offsets and counts whose sums wrap around
+    const std::uint64_t huge = (std::uint64_t)-1;
+    const std::uint64_t wrap = huge / sizeof(catalog::Entry) + 1;
+    std::uint64_t catalog::Header::* const fields[] = {
+        &catalog::Header::count, &catalog::Header::item_count, &catalog::Header::char_count
+    };
+    for (auto field : fields) {
+        catalog::Header corrupt = header;
+        corrupt.*field = wrap;
+        std::vector<std::uint64_t> copy(storage);
+        std::memcpy(copy.data(), &corrupt, sizeof(corrupt));
+        CHECK_THROWS(std::runtime_error, CatalogFile(copy.data(), size));
+    }
+
+    catalog::Entry entry;
+    char* entries = reinterpret_cast<char*>(storage.data()) + header.entries_offset;
+    std::memcpy(&entry, entries, sizeof(entry));
+    std::uint64_t catalog::Entry::* const entry_fields[] = {
+        &catalog::Entry::id_size, &catalog::Entry::item_count
+    };
+    for (auto field : entry_fields) {
+        catalog::Entry corrupt = entry;
+        corrupt.*field = huge;
+        std::vector<std::uint64_t> copy(storage);
+        std::memcpy(reinterpret_cast<char*>(copy.data()) + header.entries_offset, &corrupt, sizeof(corrupt));
+        CHECK_THROWS(std::runtime_error, CatalogFile(copy.data(), size));
+    }
+}
+
+static void write_file(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    out << data;
+    CHECK(out.good());
+}
+
+static void test_catalog_reload() {
+    const std::string path = "api_catalog_reload.txt";
+    write_file(path, "greeting = hello {}\n");
+
+    Catalog catalog(path);
+    Catalog::Reader reader = catalog.reader();
+    CHECK_EQUAL(std::string("hello x"), reader.at("greeting")("x").str());
+    const std::uint64_t generation = catalog.generation();
+
+    // the old snapshot and formats taken from it stay usable after the swap
+    Catalog::SnapshotPtr old = catalog.snapshot();
+    const Format old_greeting = old->at("greeting");
+    write_file(path, "greeting = bye {}\nother = {} {}\n");
+    catalog.reload();
+    std::remove(path.c_str());
+
+    CHECK_EQUAL(generation + 1, catalog.generation());
+    CHECK_EQUAL(generation, old->generation());
+    CHECK_EQUAL(std::string("hello x"), old_greeting("x").str());
+    CHECK_EQUAL(std::size_t(1), old->size());
+    CHECK_EQUAL(Catalog::npos, old->index("other"));
+
+    CHECK_EQUAL(std::string("bye x"), reader.at("greeting")("x").str());
+    CHECK_EQUAL(std::string("1 2"), reader.at("other")(1, 2).str());
+    CHECK_EQUAL(generation + 1, reader.snapshot().generation());
+
+    // a failed load keeps the current snapshot
+    CHECK_THROWS(std::runtime_error, catalog.load(path));
+    CHECK_EQUAL(generation + 1, catalog.generation());
+    CHECK_EQUAL(std::string("bye x"), reader.at("greeting")("x").str());
+}
+
+static void test_catalog_concurrent_reload() {
+    const CatalogEntries first  = {{"msg", "first {}"}};
+    const CatalogEntries second = {{"msg", "second {}"}};
+    Catalog catalog(first);
+
+    std::atomic<bool> done(false);
+    std::atomic<std::size_t> bad(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++ i) {
+        readers.emplace_back([&]() {
+            Catalog::Reader reader = catalog.reader();
+            while (!done.load()) {
+                const Catalog::Snapshot& snapshot = reader.snapshot();
+                const std::string text = snapshot.at("msg")(snapshot.generation()).str();
+                const std::string expected = format(snapshot.generation() % 2 ? "second {}" : "first {}", snapshot.generation()).str();
+                if (text != expected) {
+                    ++ bad;
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 1000; ++ i) {
+        catalog.assign(i % 2 ? first : second);
+    }
+    done = true;
+    for (auto& thread : readers) {
+        thread.join();
+    }
+
+    CHECK_EQUAL(std::size_t(0), bad.load());
+    CHECK_EQUAL(std::uint64_t(1000), catalog.generation());
+}
+
+static void test_binlog_rendered() {
+    const CatalogEntries entries = {
+        {"vector", "{0} {0!r} {0:*^20} {1}"},
+        {"map",    "{0!r} {0: >16}"},
+        {"float",  "{:.3f}"},
+    };
+    const std::vector<int> vector = {1, 22, 333};
+    const std::map<std::string,int> map = {{"a", 1}, {"b", 2}};
+
+    std::stringstream log;
+    BinaryLogWriter writer(log, entries);
+    writer.write(writer.index("vector"), vector, std::string("s"));
+    writer.write(writer.index("map"), map);
+    // rendered with the spec of the field, which doesn't fit
+    CHECK_THROWS(std::invalid_argument, writer.write(writer.index("float"), vector));
+
+    BinaryLogReader reader(log);
+    std::ostringstream out;
+    CHECK(reader.next(out));
+    CHECK_EQUAL(compile("{0} {0!r} {0:*^20} {1}")(vector, "s").str(), out.str());
+    out.str(std::string());
+    CHECK(reader.next(out));
+    CHECK_EQUAL(compile("{0!r} {0: >16}")(map).str(), out.str());
+    out.str(std::string());
+    CHECK(!reader.next(out));
+}
+
+static void test_binlog_bounds() {
+    const CatalogEntries entries = {{"greeting", "hello {}"}};
+    std::stringstream log;
+    BinaryLogWriter writer(log, entries);
+    CHECK_THROWS(std::out_of_range, writer.write(1, "x"));
+    CHECK_THROWS(std::out_of_range, writer.write((std::size_t)-1, "x"));
+
+    writer.write(0, "abc");
+    std::string data = log.str();
+
+    // the length of the string argument, right before its characters
+    const std::uint64_t huge = (std::uint64_t)-1 / 2;
+    std::memcpy(&data[data.size() - 3 - sizeof(huge)], &huge, sizeof(huge));
+    std::istringstream corrupt(data);
+    BinaryLogReader reader(corrupt);
+    std::ostringstream out;
+    CHECK_THROWS(std::runtime_error, reader.next(out));
+
+    // a bool is stored as one byte that must be 0 or 1
+    std::stringstream bools;
+    BinaryLogWriter bool_writer(bools, entries);
+    bool_writer.write(0, true);
+    data = bools.str();
+    {
+        std::istringstream in(data);
+        BinaryLogReader bool_reader(in);
+        CHECK(bool_reader.next(out));
+        CHECK_EQUAL(format("hello {}", true).str(), out.str());
+    }
+    CHECK_EQUAL('\1', data[data.size() - 1]);
+    data[data.size() - 1] = '\2';
+    std::istringstream bad_bool(data);
+    BinaryLogReader bad_bool_reader(bad_bool);
+    CHECK_THROWS(std::runtime_error, bad_bool_reader.next(out));
+}
+
+static void test_fixed_capacity() {
+    // 2 * 2 + 1 items and 3 literal characters
+    const char* fmt = "a{}b{}c";
+    char buffer[16];
+
+    FixedFormatItems<5, 3> exact;
+    CHECK(exact.parse(fmt) == NoFormatError);
+    CHECK_EQUAL((std::size_t)5, exact.size());
+    CHECK_EQUAL((std::size_t)5, safe_format(buffer, sizeof(buffer), exact.items(), 1, 2));
+    CHECK_EQUAL(std::string("a1b2c"), std::string(buffer));
+
+    FixedFormatItems<4, 3> few_items;
+    CHECK(few_items.parse(fmt) == CapacityExceeded);
+    CHECK(few_items.empty());
+
+    FixedFormatItems<5, 2> few_chars;
+    CHECK(few_chars.parse(fmt) == CapacityExceeded);
+    CHECK(few_chars.empty());
+
+    // escaped braces are single literal characters
+    const char* escaped = "{{x}}";
+    FixedFormatItems<1, 3> exact_escaped;
+    CHECK(exact_escaped.parse(escaped) == NoFormatError);
+    CHECK_EQUAL((std::size_t)3, safe_format(buffer, sizeof(buffer), exact_escaped.items()));
+    CHECK_EQUAL(std::string("{x}"), std::string(buffer));
+
+    FixedFormatItems<1, 2> few_escaped;
+    CHECK(few_escaped.parse(escaped) == CapacityExceeded);
+    CHECK(few_escaped.empty());
+
+    // the documented bounds always fit
+    FixedFormatItems<2 * 5 + 1, 12> bounds;
+    CHECK(bounds.parse("{}{{{}}}{}x}}") == NoFormatError);
+}
+
+static void test_try_format() {
+    std::ostringstream out;
+    out << "> ";
+    CHECK(try_format(out, "{} {:d} {}", 1, "x", 3) == InvalidArgumentFormat);
+    CHECK_EQUAL(std::string("> "), out.str());
+
+    CHECK(try_format(out, "{} {}", 1) == ArgumentIndexOutOfRange);
+    CHECK_EQUAL(std::string("> "), out.str());
+
+    CHECK(try_format(out, "{} {:d} {}", 1, 2, 3) == NoFormatError);
+    CHECK_EQUAL(std::string("> 1 2 3"), out.str());
+}
+
+// ---- allocation statistics ----
+
+#ifdef FORMATSTRING_ALLOC_STATS
+static const FormatAllocStats* find_alloc_stats(const std::vector<FormatAllocStats>& stats, const void* key) {
+    for (const FormatAllocStats& entry : stats) {
+        if (entry.key == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static void test_alloc_stats() {
+    reset_alloc_stats();
+
+    // called directly, a new expression could be optimized away
+    const AllocCounter before = thread_alloc_counter();
+    void* memory = ::operator new(400);
+    const AllocCounter after = thread_alloc_counter();
+    ::operator delete(memory);
+    CHECK_EQUAL(before.allocations + 1, after.allocations);
+    CHECK_EQUAL(before.bytes + 400, after.bytes);
+
+    const Format fmt = compile("alloc {} {}");
+    const std::string long_string(1000, 'x');
+    for (int i = 0; i < 3; ++ i) {
+        std::ostringstream out;
+        fmt.format(out, i, long_string);
+    }
+    const std::string bound = fmt(1, 2).str();
+
+    std::vector<FormatAllocStats> stats = alloc_stats();
+    const FormatAllocStats* entry = find_alloc_stats(stats, fmt.items().begin());
+    CHECK(entry != nullptr);
+    CHECK_EQUAL(std::string("alloc {} {}"), entry->label);
+    CHECK_EQUAL(std::size_t(1), entry->parse.calls);
+    CHECK(entry->parse.allocations > 0);
+    CHECK(entry->parse.bytes > 0);
+    CHECK_EQUAL(std::size_t(1), entry->bind.calls);
+    // every apply grew its ostringstream past the long string
+    CHECK_EQUAL(std::size_t(4), entry->apply.calls);
+    CHECK(entry->apply.allocations >= 3);
+    CHECK(entry->apply.bytes >= 3 * long_string.size());
+
+    // ordered by the bytes allocated in total
+    for (std::size_t i = 1; i < stats.size(); ++ i) {
+        const FormatAllocStats& lhs = stats[i - 1];
+        const FormatAllocStats& rhs = stats[i];
+        CHECK(lhs.parse.bytes + lhs.bind.bytes + lhs.apply.bytes >= rhs.parse.bytes + rhs.bind.bytes + rhs.apply.bytes);
+    }
+
+    // dumping doesn't count its own allocations
+    std::ostringstream dump;
+    dump_alloc_stats(dump);
+    CHECK(alloc_stats().size() == stats.size());
+
+    const Format columns = compile(" {: >8} {: >8} {: >10}");
+    std::string header;
+    for (const char* phase : {"parses", "binds", "applies"}) {
+        header += columns(phase, "allocs", "bytes").str();
+    }
+    header += "  format\n";
+    std::string line;
+    for (const AllocCounter* phase : {&entry->parse, &entry->bind, &entry->apply}) {
+        line += columns(phase->calls, phase->allocations, phase->bytes).str();
+    }
+    line += "  \"alloc {} {}\"\n";
+
+    const std::string text = dump.str();
+    CHECK_EQUAL(header, text.substr(0, header.size()));
+    CHECK(text.find(line) != std::string::npos);
+    CHECK_EQUAL(stats.size() + 1, (std::size_t)std::count(text.begin(), text.end(), '\n'));
+
+    reset_alloc_stats();
+    CHECK(alloc_stats().empty());
+}
+#endif
+
+// ---- format statistics ----
+
+#ifdef FORMATSTRING_FORMAT_STATS
+// not a string stream, so the output size isn't measured
+class DiscardBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override {
+        return traits_type::not_eof(ch);
+    }
+};
+
+static const FormatStatsSnapshot* find_format_stats(const std::vector<FormatStatsSnapshot>& stats, const std::string& label) {
+    for (const FormatStatsSnapshot& entry : stats) {
+        if (entry.label == label) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static const char* const OTHER_FORMATS = "(other formats)";
+static const std::size_t MAX_FORMAT_STATS = 4096;
+
+static void test_format_stats() {
+    reset_format_stats();
+
+    // quotes, a backslash and a newline, which the Prometheus dump escapes
+    const std::string label = "stats \"{}\" \\ {}\n";
+    const Format fmt = compile(label);
+    std::ostringstream out;
+    fmt.format(out, 1, "ab");
+    fmt.format(out, 22, "cd");
+    DiscardBuffer discard;
+    std::ostream unmeasured(&discard);
+    fmt.format(unmeasured, 3, "ef");
+
+    // parsed again from another buffer, twice, shares the counters
+    std::string copy = label;
+    out << format(copy, 4, 'x');
+    out << format(copy, 5, 'y');
+    const std::uint64_t bytes = out.str().size();
+
+    // the same address and size with other contents doesn't
+    copy[0] = 'S';
+    out << format(copy, 6, 'z');
+
+    std::vector<FormatStatsSnapshot> stats = format_stats();
+    const FormatStatsSnapshot* entry = find_format_stats(stats, label);
+    CHECK(entry != nullptr);
+    CHECK_EQUAL(std::uint64_t(5), entry->applies);
+    CHECK_EQUAL(std::uint64_t(4), entry->measured);
+    CHECK_EQUAL(bytes, entry->bytes);
+    CHECK(entry->max_nanos <= entry->nanos);
+    CHECK_EQUAL(std::uint64_t(5), entry->args[IntegerArg]);
+    CHECK_EQUAL(std::uint64_t(3), entry->args[StringArg]);
+    CHECK_EQUAL(std::uint64_t(2), entry->args[CharArg]);
+    CHECK_EQUAL(std::uint64_t(0), entry->args[FloatArg]);
+
+    const FormatStatsSnapshot* changed = find_format_stats(stats, copy);
+    CHECK(changed != nullptr);
+    CHECK_EQUAL(std::uint64_t(1), changed->applies);
+    CHECK_EQUAL(std::uint64_t(out.str().size() - bytes), changed->bytes);
+
+    // ordered by the time spent in total
+    for (std::size_t i = 1; i < stats.size(); ++ i) {
+        CHECK(stats[i - 1].nanos >= stats[i].nanos);
+    }
+
+    const std::string header = compile("{: >10} {: >12} {: >12} {: >10} {: >10}  format\n")("applies", "bytes", "total ms", "mean us", "max us").str();
+
+    // dumps don't register the formats they use
+    const std::size_t registered = format_stats().size();
+    std::ostringstream text;
+    dump_format_stats(text);
+    std::ostringstream prometheus;
+    dump_format_stats(prometheus, PrometheusDump);
+    CHECK_EQUAL(registered, format_stats().size());
+    CHECK_EQUAL(header, text.str().substr(0, header.size()));
+
+    const std::string dump = prometheus.str();
+    const std::string escaped = "format=\"stats \\\"{}\\\" \\\\ {}\\n\"";
+    const char* const expected[] = {
+        "# HELP formatstring_applies_total Number of times the format was applied.\n"
+        "# TYPE formatstring_applies_total counter\n",
+        "# TYPE formatstring_measured_applies_total counter\n",
+        "# TYPE formatstring_bytes_total counter\n",
+        "# TYPE formatstring_seconds_total counter\n",
+        "# TYPE formatstring_max_seconds gauge\n",
+        "# TYPE formatstring_args_total counter\n",
+    };
+    for (const char* text : expected) {
+        CHECK(dump.find(text) != std::string::npos);
+    }
+    CHECK(dump.find("formatstring_applies_total{" + escaped + "} 5\n") != std::string::npos);
+    CHECK(dump.find("formatstring_measured_applies_total{" + escaped + "} 4\n") != std::string::npos);
+    CHECK(dump.find(format("formatstring_bytes_total{{{}}} {}\n", escaped, bytes).str()) != std::string::npos);
+    CHECK(dump.find("formatstring_args_total{" + escaped + ",kind=\"integer\"} 5\n") != std::string::npos);
+    CHECK(dump.find("formatstring_args_total{" + escaped + ",kind=\"char\"} 2\n") != std::string::npos);
+    CHECK(dump.find("kind=\"float\"") == std::string::npos);
+
+    // one sample or comment per line
+    std::istringstream lines(dump);
+    std::string line;
+    while (std::getline(lines, line)) {
+        CHECK(line.compare(0, 13, "formatstring_") == 0 || line.compare(0, 20, "# HELP formatstring_") == 0 ||
+              line.compare(0, 20, "# TYPE formatstring_") == 0);
+    }
+}
+
+static void test_format_stats_limit() {
+    std::vector<FormatStatsSnapshot> stats = format_stats();
+    const FormatStatsSnapshot* other = find_format_stats(stats, OTHER_FORMATS);
+    const std::uint64_t other_applies = other ? other->applies : 0;
+    const std::size_t registered = stats.size() - (other ? 1 : 0);
+    CHECK(registered <= MAX_FORMAT_STATS);
+
+    // fill up the registry, the format strings are built without format()
+    // so that only they are registered
+    for (std::size_t i = registered; i < MAX_FORMAT_STATS; ++ i) {
+        compile("limit " + std::to_string(i) + " {}");
+    }
+    stats = format_stats();
+    CHECK_EQUAL(MAX_FORMAT_STATS + (other ? 1 : 0), stats.size());
+
+    const Format first = compile("over the limit {}");
+    const Format second = compile("also over the limit {}");
+    CHECK_EQUAL(std::string("over the limit 1"), first(1).str());
+    CHECK_EQUAL(std::string("also over the limit 2"), second(2).str());
+    CHECK_EQUAL(std::string("also over the limit 3"), second(3).str());
+
+    // known format strings keep their own counters
+    const std::string label = "stats \"{}\" \\ {}\n";
+    std::ostringstream out;
+    out << format(label, 7, 8);
+
+    stats = format_stats();
+    CHECK_EQUAL(MAX_FORMAT_STATS + 1, stats.size());
+    CHECK(find_format_stats(stats, "over the limit {}") == nullptr);
+    CHECK(find_format_stats(stats, "also over the limit {}") == nullptr);
+    other = find_format_stats(stats, OTHER_FORMATS);
+    CHECK(other != nullptr);
+    CHECK_EQUAL(other_applies + 3, other->applies);
+    CHECK_EQUAL(std::uint64_t(6), find_format_stats(stats, label)->applies);
+}
+#endif
+
+#ifdef FORMATSTRING_TEST_CXX17
+// api17.cpp
+void test_string_view();
+#endif
+
+typedef void (*Test)();
+
+static const std::pair<const char*, Test> tests[] = {
+    {"format copy",             test_format_copy},
+    {"format move",             test_format_move},
+    {"items view",              test_items_view},
+    {"ref outlives handle",     test_ref_outlives_handle},
+    {"literal merging",         test_literal_merging},
+    {"owned outlives arguments", test_owned_outlives_arguments},
+    {"owned outlives format",   test_owned_outlives_format},
+    {"owned strings",           test_owned_strings},
+    {"owned assign",            test_owned_assign},
+    {"async drop",              test_async_drop},
+    {"async drop oldest",       test_async_drop_oldest},
+    {"async block",             test_async_block},
+    {"shared stream",           test_shared_stream},
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    {"shared fd",               test_shared_fd},
+#endif
+    {"scratch growth",          test_scratch_growth},
+    {"batch order",             test_batch_order},
+    {"batch error",             test_batch_error},
+    {"print file",              test_print_file},
+#ifdef FORMATSTRING_POSIX_IO_SUPPORT
+    {"print fd",                test_print_fd},
+    {"vectored segments",       test_vectored_segments},
+    {"vectored partial",        test_vectored_partial},
+#endif
+    {"catalog bounds",          test_catalog_bounds},
+    {"catalog reload",          test_catalog_reload},
+    {"catalog concurrent reload", test_catalog_concurrent_reload},
+    {"binlog rendered",         test_binlog_rendered},
+    {"binlog bounds",           test_binlog_bounds},
+    {"fixed capacity",          test_fixed_capacity},
+    {"try format",              test_try_format},
+#ifdef FORMATSTRING_ALLOC_STATS
+    {"alloc stats",             test_alloc_stats},
+#endif
+#ifdef FORMATSTRING_FORMAT_STATS
+    {"format stats",            test_format_stats},
+    {"format stats limit",      test_format_stats_limit},
+#endif
+#ifdef FORMATSTRING_TEST_CXX17
+    {"string_view",             test_string_view},
+#endif
+};
+
+int main() {
+    int failed = 0;
+    for (const auto& test : tests) {
+        try {
+            test.second();
+            std::cout << "[  OK  ] " << test.first << '\n';
+        }
+        catch (const std::exception& exc) {
+            std::cout << "[ FAIL ] " << test.first << ": " << exc.what() << '\n';
+            ++ failed;
+        }
+    }
+    return failed;
+}
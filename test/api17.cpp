@@ -0,0 +1,45 @@
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <formatstring.h>
+
+#include "check.h"
+
+using namespace formatstring;
+
+// Built as C++17 without optimization, so the std::string_view overloads
+// are actually called instead of inlined and must either be instantiated
+// here or be found in the library.
+
+#ifndef FORMATSTRING_STRING_VIEW_SUPPORT
+#   error "api17.cpp must be compiled as C++17 or later"
+#endif
+
+void test_string_view() {
+    const std::string buffer = "[{} {: >4}] and more";
+    const std::string_view fmt(buffer.data(), 11);
+
+    Format compiled(fmt);
+    CHECK_EQUAL(std::string("[1    2]"), compiled(1, 2).str());
+    CHECK_EQUAL(std::string("[a    b]"), compile(fmt)("a", "b").str());
+    CHECK_EQUAL(std::string("[x    y]"), format(fmt, "x", "y").str());
+    CHECK_EQUAL(std::size_t(5), parse_format(fmt).size());
+
+    const std::wstring wbuffer = L"{:*^5}!";
+    WFormat wcompiled(std::wstring_view(wbuffer.data(), 6));
+    CHECK(wcompiled(L"a").str() == L"**a**");
+
+    const std::string_view specs = " >8.3fxyz";
+    FormatSpec spec(specs.substr(0, 6));
+    CHECK_EQUAL(8, spec.width);
+    CHECK_EQUAL(3, spec.precision);
+    CHECK(spec.alignment == FormatSpec::Right);
+    CHECK(spec.type == FormatSpec::Fixed);
+
+    spec = std::string_view("_<4");
+    CHECK_EQUAL(4, spec.width);
+    CHECK_EQUAL('_', spec.fill);
+    CHECK(spec.alignment == FormatSpec::Left);
+    CHECK(spec.equals(parse_spec(std::string_view("_<4"))));
+}
@@ -0,0 +1,46 @@
+#ifndef FORMATSTRING_TEST_CHECK_H
+#define FORMATSTRING_TEST_CHECK_H
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+#include <formatstring.h>
+
+// assertions of the api tests, a failed check throws TestFailure
+
+class TestFailure : public std::runtime_error {
+public:
+    TestFailure(const std::string& message) : std::runtime_error(message) {}
+};
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        throw TestFailure(formatstring::format("line {}: {}", __LINE__, #cond).str()); \
+    }
+
+#define CHECK_EQUAL(expected, actual) \
+    { \
+        auto check_expected = (expected); \
+        auto check_actual   = (actual); \
+        if (!(check_expected == check_actual)) { \
+            throw TestFailure(formatstring::format("line {}: {} == {}: {!r} != {!r}", \
+                __LINE__, #expected, #actual, check_expected, check_actual).str()); \
+        } \
+    }
+
+#define CHECK_THROWS(exception, expr) \
+    { \
+        bool check_thrown = false; \
+        try { \
+            expr; \
+        } \
+        catch (const exception&) { \
+            check_thrown = true; \
+        } \
+        if (!check_thrown) { \
+            throw TestFailure(formatstring::format("line {}: {} didn't throw {}", __LINE__, #expr, #exception).str()); \
+        } \
+    }
+
+#endif // FORMATSTRING_TEST_CHECK_H
@@ -564,6 +564,68 @@ void do_format_array(const char* fmt, std::size_t argc, const char* argv[]) {
 const std::string STD_NS = "std::";
 const std::string ARRAY_BRACKETS = "[]";
 
+inline SafeArg safe_arg(const std::string& value) {
+    return SafeArg(value.c_str());
+}
+
+template<typename T>
+inline SafeArg safe_arg(const T& value) {
+    return SafeArg(value);
+}
+
+// Prints the output of safe_format() with the format string. Fails if
+// safe_format() with the compiled items or format() disagree with it.
+template<typename ParseType, typename UseType = ParseType>
+void do_safe_format_value(const char* fmt, const char* value) {
+    UseType arg = (UseType)lexical_cast<ParseType>(value);
+    const Format compiled = compile(fmt);
+
+    char buffer[1024];
+    std::string safe(buffer, safe_format(buffer, sizeof(buffer), fmt, safe_arg(arg)));
+    std::string items(buffer, safe_format(buffer, sizeof(buffer), compiled.items(), safe_arg(arg)));
+    std::string formatted = format(fmt, arg).str();
+
+    if (items != safe) {
+        throw std::runtime_error(format("safe_format() with items: {!r} != {!r}", items, safe).str());
+    }
+    if (formatted != safe) {
+        throw std::runtime_error(format("format(): {!r} != {!r}", formatted, safe).str());
+    }
+    std::cout << safe;
+}
+
+void do_safe_format(const char* fmt, const std::string& type, std::size_t argc, const char* argv[]) {
+    if (argc != 1) {
+        throw std::range_error("illegal number of arguments");
+    }
+
+    std::string name = type.compare(0, STD_NS.size(), STD_NS) == 0 ? type.substr(STD_NS.size()) : type;
+    if (name == "char[]") {
+        do_safe_format_value<const char*>(fmt, argv[0]);
+        return;
+    }
+
+    switch (parse_value_type(name)) {
+    case Bool:       do_safe_format_value<bool>(fmt, argv[0]); break;
+    case Short:      do_safe_format_value<short>(fmt, argv[0]); break;
+    case Int:        do_safe_format_value<int>(fmt, argv[0]); break;
+    case Long:       do_safe_format_value<long>(fmt, argv[0]); break;
+    case LongLong:   do_safe_format_value<long long>(fmt, argv[0]); break;
+    case UShort:     do_safe_format_value<unsigned short>(fmt, argv[0]); break;
+    case UInt:       do_safe_format_value<unsigned int>(fmt, argv[0]); break;
+    case ULong:      do_safe_format_value<unsigned long>(fmt, argv[0]); break;
+    case ULongLong:  do_safe_format_value<unsigned long long>(fmt, argv[0]); break;
+    case Int16:      do_safe_format_value<std::int16_t>(fmt, argv[0]); break;
+    case Int32:      do_safe_format_value<std::int32_t>(fmt, argv[0]); break;
+    case Int64:      do_safe_format_value<std::int64_t>(fmt, argv[0]); break;
+    case UInt16:     do_safe_format_value<std::uint16_t>(fmt, argv[0]); break;
+    case UInt32:     do_safe_format_value<std::uint32_t>(fmt, argv[0]); break;
+    case UInt64:     do_safe_format_value<std::uint64_t>(fmt, argv[0]); break;
+    case String:     do_safe_format_value<std::string>(fmt, argv[0]); break;
+    default: throw std::invalid_argument(type);
+    }
+}
+
 void do_format(const char* fmt, const std::string& type, std::size_t argc, const char* argv[]) {
     auto i = type.cbegin();
     auto e = type.cend();
@@ -702,20 +764,28 @@ void do_format(const char* fmt, const std::string& type, std::size_t argc, const
 }
 
 void usage(int argc, const char* argv[]) {
-    std::cout << "usage: " << (argc > 0 ? argv[0] : "format") << " <format> <type> <value>...\n";
+    std::cout << "usage: " << (argc > 0 ? argv[0] : "format") << " [--safe] <format> <type> <value>...\n";
 }
 
 int main(int argc, const char* argv[]) {
-    const char* fmt = argv[1];
+    bool safe = argc > 1 && std::strcmp(argv[1], "--safe") == 0;
+    int first = safe ? 2 : 1;
 
-    if (argc < 3) {
+    if (argc < first + 2) {
         std::cerr << "illegal number of arguments\n";
         usage(argc, argv);
         return 1;
     }
 
+    const char* fmt = argv[first];
+
     try {
-        do_format(fmt, argv[2], argc - 3, argv + 3);
+        if (safe) {
+            do_safe_format(fmt, argv[first + 1], argc - first - 2, argv + first + 2);
+        }
+        else {
+            do_format(fmt, argv[first + 1], argc - first - 2, argv + first + 2);
+        }
     }
     catch (const std::invalid_argument& exc) {
         std::cerr << "invalid argument: " << exc.what() << '\n';
@@ -175,7 +175,25 @@ testcases = [
 	('std::string', str_values, str_formats)
 ]
 
-def run_test(binary,tp,fmt,value):
+# safe_format() can't format floats and ignores ',' when padding with '0'
+SAFE_UNSUPPORTED = re.compile(r'[eEfF%]}$|:(_[<>=^])?[-+ ]?#?0\d*,')
+
+safe_int_formats = [fmt for fmt in int_formats if SAFE_UNSUPPORTED.search(fmt) is None]
+
+safe_testcases = [
+	('std::int16_t', int16_values, safe_int_formats),
+	('std::int32_t', int32_values, safe_int_formats),
+	('std::int64_t', int64_values, safe_int_formats),
+
+	('std::uint16_t', uint16_values, safe_int_formats),
+	('std::uint32_t', uint32_values, safe_int_formats),
+	('std::uint64_t', uint64_values, safe_int_formats),
+
+	('char[]', str_values, str_formats),
+	('std::string', str_values, str_formats)
+]
+
+def run_test(binary,tp,fmt,value,options=[]):
 	pytp    = type(value)
 	is_str  = pytp is str
 	is_repr = HAS_REPR.search(fmt) is not None
@@ -204,7 +222,7 @@ def run_test(binary,tp,fmt,value):
 		pyres = pyres.replace("'",'"')
 
 #	sys.stdout.write("         %r: %r == ...\n" % (value, pyres))
-	pipe = Popen([binary, fmt, tp, svalue], stdout=PIPE, stderr=PIPE)
+	pipe = Popen([binary] + options + [fmt, tp, svalue], stdout=PIPE, stderr=PIPE)
 	if pipe.wait() == 0:
 		cppres = pipe.stdout.read().decode('latin1')
 		if pyres == cppres:
@@ -224,5 +242,21 @@ def run_tests(binary):
 				run_test(binary,tp,fmt,value)
 		sys.stdout.write("\n")
 
+	# the driver also checks that format() gives the same output
+	for tp, values, formats in safe_testcases:
+		for fmt in formats:
+			for value in values:
+				run_test(binary,tp,fmt,value,['--safe'])
+		sys.stdout.write("\n")
+
+def run_api_tests(binary):
+	pipe = Popen([binary], stdout=PIPE, stderr=PIPE)
+	status = pipe.wait()
+	sys.stdout.write(pipe.stdout.read().decode('utf-8'))
+	if status < 0:
+		sys.stdout.write("[ FAIL ] %s: killed by signal %d\n" % (binary, -status))
+
 if __name__ == '__main__':
 	run_tests(sys.argv[1])
+	if len(sys.argv) > 2:
+		run_api_tests(sys.argv[2])
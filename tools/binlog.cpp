@@ -0,0 +1,33 @@
+#include <iostream>
+#include <fstream>
+
+#include <formatstring.h>
+
+using namespace formatstring;
+
+// Renders a binary log written with BinaryLogWriter as text.
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <log.bin>\n";
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::in | std::ios::binary);
+    if (!in) {
+        std::cerr << argv[1] << ": cannot open file\n";
+        return 1;
+    }
+
+    try {
+        BinaryLogReader reader(in);
+        while (reader.next(std::cout)) {}
+    }
+    catch (const std::exception& exc) {
+        std::cout.flush();
+        std::cerr << argv[1] << ": " << exc.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include <formatstring.h>
+
+using namespace formatstring;
+
+// Compiles a text catalog of format strings into a binary catalog that can
+// be loaded with CatalogFile::open() without parsing anything at runtime.
+
+static void usage(const char* program) {
+    std::cerr << "usage: " << program << " <input.txt> <output.bin>\n"
+                 "       " << program << " --list <catalog.bin>\n";
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        if (std::strcmp(argv[1], "--list") == 0) {
+            CatalogFile catalog = CatalogFile::open(argv[2]);
+            for (std::size_t i = 0; i < catalog.size(); ++ i) {
+                std::cout << catalog.id(i) << ": " << catalog.format(i).items().size() << " items\n";
+            }
+            return 0;
+        }
+
+        std::ifstream in(argv[1]);
+        if (!in) {
+            std::cerr << argv[1] << ": cannot open file\n";
+            return 1;
+        }
+
+        CatalogWriter writer;
+        for (auto& entry : read_text_catalog(in)) {
+            try {
+                writer.add(entry.first, entry.second);
+            }
+            catch (const std::invalid_argument& exc) {
+                std::cerr << argv[1] << ": " << entry.first << ": " << exc.what() << '\n';
+                return 1;
+            }
+        }
+
+        std::ofstream out(argv[2], std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << argv[2] << ": cannot open file\n";
+            return 1;
+        }
+
+        writer.write(out);
+        out.close();
+
+        if (!out) {
+            std::cerr << argv[2] << ": write error\n";
+            return 1;
+        }
+    }
+    catch (const std::exception& exc) {
+        std::cerr << exc.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}